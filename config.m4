@@ -13,14 +13,29 @@ if test "$PHP_TASK" != "no"; then
     task_use_ucontext="yes"
   ])
 
+  AC_CHECK_HEADERS([poll.h sys/signalfd.h sys/sendfile.h])
+  AC_CHECK_FUNCS([splice])
+
   task_source_files="php_task.c \
     src/fiber.c \
     src/fiber_stack.c \
     src/awaitable.c \
+    src/cancellation.c \
+    src/channel.c \
     src/context.c \
     src/deferred.c \
+    src/hamt.c \
+    src/io_watcher.c \
+    src/server.c \
+    src/signal_watcher.c \
+    src/socket.c \
+    src/stream.c \
+    src/sync.c \
     src/task.c \
-    src/task_scheduler.c"
+    src/task_group.c \
+    src/task_local.c \
+    src/task_scheduler.c \
+    src/thenable.c"
   
   AS_CASE([$host_cpu],
     [x86_64*], [task_cpu="x86_64"],
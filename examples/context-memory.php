@@ -0,0 +1,59 @@
+<?php
+
+use Concurrent\Context;
+
+// Measures memory (bytes reported by memory_get_usage()) and time per context derived using with() from contexts of
+// different sizes and the time per lookup. Contexts with up to 8 variables store them inline, larger contexts switch
+// to a persistent map.
+//
+// PHP does not expose the number of allocations, this script does not count them. Run it for a single context size
+// with two different numbers of iterations and compare the "total heap usage" reported by valgrind. The difference
+// divided by the difference in iterations is the number of allocations per iteration, this includes one allocation
+// for the variable name built by the loop:
+//
+// USE_ZEND_ALLOC=0 valgrind php examples/context-memory.php 10000 8
+// USE_ZEND_ALLOC=0 valgrind php examples/context-memory.php 20000 8
+
+$iterations = (int) ($argv[1] ?? 10000);
+$sizes = isset($argv[2]) ? [(int) $argv[2]] : [1, 4, 8, 9, 10, 100, 1000];
+
+foreach ($sizes as $size) {
+    $context = Context::inherit();
+
+    for ($i = 0; $i < $size; $i++) {
+        $context = $context->with('var' . $i, $i);
+    }
+
+    $derived = [];
+    $memory = memory_get_usage();
+    $time = microtime(true);
+
+    for ($i = 0; $i < $iterations; $i++) {
+        $derived[] = $context->with('var' . ($i % $size), $i);
+    }
+
+    $time = microtime(true) - $time;
+    $memory = memory_get_usage() - $memory;
+
+    $names = [];
+
+    for ($i = 0; $i < $size; $i++) {
+        $names[] = 'var' . $i;
+    }
+
+    $lookup = microtime(true);
+
+    for ($i = 0; $i < $iterations; $i++) {
+        $context->get($names[$i % $size]);
+    }
+
+    $lookup = microtime(true) - $lookup;
+
+    printf(
+        "%5d vars: %6.0f bytes / %6.2f us per derived context, %6.3f us per lookup\n",
+        $size,
+        $memory / $iterations,
+        $time * 1000000 / $iterations,
+        $lookup * 1000000 / $iterations
+    );
+}
@@ -26,6 +26,7 @@ BEGIN_EXTERN_C()
 extern zend_class_entry *concurrent_awaitable_ce;
 
 typedef struct _concurrent_awaitable_cb concurrent_awaitable_cb;
+typedef struct _concurrent_awaitable_queue concurrent_awaitable_queue;
 
 typedef void (* concurrent_awaitable_func)(void *obj, zval *result, zend_bool success);
 
@@ -35,13 +36,31 @@ struct _concurrent_awaitable_cb {
 	concurrent_awaitable_cb *next;
 };
 
-concurrent_awaitable_cb *concurrent_awaitable_create_continuation(void *obj, concurrent_awaitable_func func);
-void concurrent_awaitable_append_continuation(concurrent_awaitable_cb *prev, void *obj, concurrent_awaitable_func func);
+struct _concurrent_awaitable_queue {
+	/* Linked list of registered continuations (first and last), the inline slot is linked like any other node. */
+	concurrent_awaitable_cb *first;
+	concurrent_awaitable_cb *last;
 
-void concurrent_awaitable_trigger_continuation(concurrent_awaitable_cb **cont, zval *result, zend_bool success);
-void concurrent_awaitable_dispose_continuation(concurrent_awaitable_cb **cont);
+	/* Inline storage of one continuation, the slot is unused if func is NULL. */
+	concurrent_awaitable_cb slot;
+};
+
+void concurrent_awaitable_append_continuation(concurrent_awaitable_queue *queue, void *obj, concurrent_awaitable_func func);
+
+void concurrent_awaitable_trigger_continuation(concurrent_awaitable_queue *queue, zval *result, zend_bool success);
+void concurrent_awaitable_dispose_continuation(concurrent_awaitable_queue *queue);
+zend_bool concurrent_awaitable_remove_continuation(concurrent_awaitable_queue *queue, void *obj, concurrent_awaitable_func func);
+
+zend_bool concurrent_awaitable_register(zend_object *awaitable, void *obj, concurrent_awaitable_func func, zval **result, zend_bool *success);
+void concurrent_awaitable_unregister(zend_object *awaitable, void *obj, concurrent_awaitable_func func);
+
+/* Transform methods, shared by all implementations of the Awaitable interface. */
+ZEND_METHOD(Awaitable, map);
+ZEND_METHOD(Awaitable, catch);
+ZEND_METHOD(Awaitable, finally);
 
 void concurrent_awaitable_ce_register();
+void concurrent_awaitable_shutdown();
 
 END_EXTERN_C()
 
@@ -0,0 +1,58 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_CANCELLATION_H
+#define CONCURRENT_CANCELLATION_H
+
+#include "php.h"
+
+typedef struct _concurrent_task concurrent_task;
+
+BEGIN_EXTERN_C()
+
+extern zend_class_entry *concurrent_cancellation_token_ce;
+extern zend_class_entry *concurrent_cancellation_exception_ce;
+
+typedef struct _concurrent_cancellation_token concurrent_cancellation_token;
+
+struct _concurrent_cancellation_token {
+	/* Cancellation token PHP object handle. */
+	zend_object std;
+
+	/* Started tasks that use the token (not referenced), indexed by task ID, allocated on first use. */
+	HashTable *tasks;
+
+	/* Cancellation exception, UNDEF until the token is cancelled. */
+	zval error;
+};
+
+void concurrent_cancellation_create_exception(zval *error, const char *message, zval *previous);
+
+void concurrent_cancellation_token_attach(concurrent_cancellation_token *token, concurrent_task *task);
+void concurrent_cancellation_token_detach(concurrent_cancellation_token *token, concurrent_task *task);
+
+void concurrent_cancellation_ce_register();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,65 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_CHANNEL_H
+#define CONCURRENT_CHANNEL_H
+
+#include "php.h"
+#include "task.h"
+
+BEGIN_EXTERN_C()
+
+extern zend_class_entry *concurrent_channel_ce;
+
+typedef struct _concurrent_channel concurrent_channel;
+
+struct _concurrent_channel {
+	/* Channel PHP object handle. */
+	zend_object std;
+
+	/* Ring buffer of values that have been sent but not received yet. */
+	zval *buffer;
+
+	/* Max number of buffered values, 0 creates an unbuffered channel. */
+	uint32_t capacity;
+
+	/* Position of the next value to be received and number of buffered values. */
+	uint32_t head;
+	uint32_t count;
+
+	/* Tasks waiting for a value to be sent to the channel. */
+	concurrent_task_wait_queue receivers;
+
+	/* Tasks waiting for buffer space or a receiver. */
+	concurrent_task_wait_queue senders;
+
+	zend_bool closed;
+};
+
+zend_bool concurrent_channel_try_receive(concurrent_channel *channel, zval *value);
+
+void concurrent_channel_ce_register();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
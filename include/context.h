@@ -20,32 +20,76 @@
 #define CONCURRENT_CONTEXT_H
 
 #include "php.h"
+#include "hamt.h"
+
+typedef struct _concurrent_cancellation_token concurrent_cancellation_token;
 
 BEGIN_EXTERN_C()
 
 extern zend_class_entry *concurrent_context_ce;
+extern zend_class_entry *concurrent_context_key_ce;
 
 typedef struct _concurrent_context concurrent_context;
+typedef struct _concurrent_context_key concurrent_context_key;
+typedef struct _concurrent_context_cache_entry concurrent_context_cache_entry;
+
+#define CONCURRENT_CONTEXT_CACHE_SIZE 8
+
+/* Maximum number of variables stored inline, contexts with more variables use a persistent map. */
+#define CONCURRENT_CONTEXT_INLINE_VARS 8
+
+struct _concurrent_context_cache_entry {
+	/* Interned variable name, NULL if the entry is unused. */
+	zend_string *key;
+
+	/* Value found in the context or one of its parents, NULL if the variable is not set. */
+	zval *value;
+};
 
 struct _concurrent_context {
 	zend_object std;
 
 	concurrent_context *parent;
 
-	uint32_t param_count;
+	/* Number of ancestors of the context, bounded by the task.context_depth INI setting. */
+	uint32_t depth;
+
+	/* Monotonic time (in microseconds) when suspended tasks using the context are cancelled, 0 if there is no deadline. */
+	zend_long deadline;
+
+	/* Cancellation token shared by all contexts derived from this context. */
+	concurrent_cancellation_token *token;
+
+	/* Variables of large contexts, versions created by with() and without() share unmodified parts of the map. */
+	concurrent_hamt vars;
+
+	/* Values of context keys, copied from the parent on creation so that lookups never walk the parent chain. */
+	concurrent_hamt keys;
+
+	/* Direct mapped cache of variable lookups, allocated on first lookup of an interned name. */
+	concurrent_context_cache_entry *cache;
+
+	/* Number of variables stored inline, always 0 if the variables are stored in vars. */
+	uint32_t var_count;
+
+	/* Variables of small contexts, allocated together with the context object. */
+	concurrent_hamt_entry inline_vars[1];
+};
+
+struct _concurrent_context_key {
+	zend_object std;
+
+	/* Unique name of the key slot, the hash of the name is the slot index. */
+	zend_string *slot;
 
-	union {
-		struct {
-			zend_string *name;
-			zval value;
-		} var;
-		HashTable *params;
-	} data;
+	/* Description of the key provided by userland code. */
+	zend_string *description;
 };
 
 concurrent_context *concurrent_context_object_create(HashTable *params);
 
 concurrent_context *concurrent_context_get();
+zval *concurrent_context_lookup(concurrent_context *context, zval *var);
 
 void concurrent_context_ce_register();
 void concurrent_context_shutdown();
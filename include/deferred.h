@@ -37,8 +37,11 @@ struct _concurrent_deferred {
 
 	zval result;
 
-	/* Linked list of registered continuation callbacks. */
-	concurrent_awaitable_cb *continuation;
+	/* Registered continuation callbacks, the first one is stored inline. */
+	concurrent_awaitable_queue continuation;
+
+	/* Awaitable returned by Deferred::awaitable(), it holds a reference to the deferred but not vice versa. */
+	concurrent_deferred_awaitable *awaitable;
 };
 
 extern const zend_uchar CONCURRENT_DEFERRED_STATUS_PENDING;
@@ -48,10 +51,21 @@ extern const zend_uchar CONCURRENT_DEFERRED_STATUS_FAILED;
 struct _concurrent_deferred_awaitable {
 	zend_object std;
 
+	/* Deferred that resolves the awaitable, NULL if the awaitable has been created in a resolved state. */
 	concurrent_deferred *defer;
+
+	/* Outcome of an awaitable that has been created in a resolved state. */
+	zend_uchar status;
+	zval result;
 };
 
+concurrent_deferred *concurrent_deferred_create();
+void concurrent_deferred_get_awaitable(concurrent_deferred *defer, zval *obj);
+void concurrent_deferred_resolve(concurrent_deferred *defer, zval *val);
+void concurrent_deferred_fail(concurrent_deferred *defer, zval *error);
+
 void concurrent_deferred_ce_register();
+void concurrent_deferred_shutdown();
 
 END_EXTERN_C()
 
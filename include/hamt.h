@@ -0,0 +1,75 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_HAMT_H
+#define CONCURRENT_HAMT_H
+
+#include "php.h"
+
+BEGIN_EXTERN_C()
+
+typedef struct _concurrent_hamt concurrent_hamt;
+typedef struct _concurrent_hamt_node concurrent_hamt_node;
+typedef struct _concurrent_hamt_entry concurrent_hamt_entry;
+
+/*
+ * Persistent hash array mapped trie with string keys. Maps are immutable, every modification creates a new version
+ * that shares all nodes that are not on the path to the modified key with the previous version.
+ */
+struct _concurrent_hamt {
+	/* Root node, NULL if the map is empty. */
+	concurrent_hamt_node *root;
+
+	/* Number of entries in the map. */
+	uint32_t count;
+};
+
+struct _concurrent_hamt_entry {
+	zend_string *key;
+	zval value;
+};
+
+struct _concurrent_hamt_node {
+	/* Number of maps and parent nodes that share the node. */
+	uint32_t refcount;
+
+	/* Bitmaps of slots that contain an entry or a child node, collision nodes store the number of entries in datamap. */
+	uint32_t datamap;
+	uint32_t nodemap;
+
+	/* Entries of the node followed by pointers to child nodes. */
+	concurrent_hamt_entry entries[1];
+};
+
+zval *concurrent_hamt_find(concurrent_hamt *map, zend_string *key);
+
+void concurrent_hamt_copy(concurrent_hamt *map, concurrent_hamt *src);
+void concurrent_hamt_set(concurrent_hamt *map, concurrent_hamt *src, zend_string *key, zval *value);
+void concurrent_hamt_assign(concurrent_hamt *map, zend_string *key, zval *value);
+void concurrent_hamt_remove(concurrent_hamt *map, concurrent_hamt *src, zend_string *key);
+void concurrent_hamt_merge(concurrent_hamt *map, concurrent_hamt *src, concurrent_hamt *defaults);
+void concurrent_hamt_destroy(concurrent_hamt *map);
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
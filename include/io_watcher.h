@@ -0,0 +1,75 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_IO_WATCHER_H
+#define CONCURRENT_IO_WATCHER_H
+
+#include "php.h"
+
+BEGIN_EXTERN_C()
+
+typedef struct _concurrent_io_watcher concurrent_io_watcher;
+
+typedef void (* concurrent_io_watcher_func)(concurrent_io_watcher *watcher, int events);
+
+struct _concurrent_io_watcher {
+	/* Native file descriptor being watched. */
+	int fd;
+
+	/* Events to watch for, combination of CONCURRENT_IO_WATCHER_* constants. */
+	int events;
+
+	/* Events reported by the last poll, will be passed to the callback. */
+	int revents;
+
+	/* Callback to be invoked when the descriptor becomes ready. */
+	concurrent_io_watcher_func func;
+
+	/* Arbitrary data being used by the callback. */
+	void *object;
+
+	/* Doubly linked list of active watchers. */
+	concurrent_io_watcher *prev;
+	concurrent_io_watcher *next;
+
+	/* Next watcher in the list of watchers waiting for their callback to be invoked. */
+	concurrent_io_watcher *ready;
+
+	zend_bool active;
+};
+
+extern const int CONCURRENT_IO_WATCHER_READABLE;
+extern const int CONCURRENT_IO_WATCHER_WRITABLE;
+
+void concurrent_io_watcher_start(concurrent_io_watcher *watcher);
+void concurrent_io_watcher_stop(concurrent_io_watcher *watcher);
+
+int concurrent_io_watcher_poll(zend_long timeout);
+
+zend_bool concurrent_io_watcher_await(int fd, int events, zend_execute_data *execute_data);
+
+void concurrent_io_watcher_shutdown();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
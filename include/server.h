@@ -0,0 +1,69 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_SERVER_H
+#define CONCURRENT_SERVER_H
+
+#include "php.h"
+#include "io_watcher.h"
+
+typedef struct _concurrent_context concurrent_context;
+typedef struct _concurrent_task_scheduler concurrent_task_scheduler;
+
+BEGIN_EXTERN_C()
+
+extern zend_class_entry *concurrent_server_ce;
+
+typedef struct _concurrent_server concurrent_server;
+
+struct _concurrent_server {
+	/* Server PHP object handle. */
+	zend_object std;
+
+	/* Native watcher of the listening socket. */
+	concurrent_io_watcher io;
+
+	/* Task scheduler being used to run connection tasks. */
+	concurrent_task_scheduler *scheduler;
+
+	/* Async execution context provided to connection tasks. */
+	concurrent_context *context;
+
+	/* Callback to be run in a new task for every accepted connection. */
+	zend_fcall_info fci;
+	zend_fcall_info_cache fcc;
+
+	/* Number of connection tasks that have not completed yet. */
+	zend_long in_flight;
+
+	/* Max number of connection tasks, accepting is paused when the limit is reached (0 means no limit). */
+	zend_long max_in_flight;
+
+	zend_bool closed;
+};
+
+void concurrent_server_ce_register();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,60 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_SIGNAL_WATCHER_H
+#define CONCURRENT_SIGNAL_WATCHER_H
+
+#include "php.h"
+#include "awaitable.h"
+#include "io_watcher.h"
+
+typedef struct _concurrent_task concurrent_task;
+
+BEGIN_EXTERN_C()
+
+#define CONCURRENT_SIGNAL_WATCHER_MAX 65
+
+typedef struct _concurrent_signal_watcher concurrent_signal_watcher;
+
+struct _concurrent_signal_watcher {
+	/* Native watcher of the signal file descriptor. */
+	concurrent_io_watcher io;
+
+	/* Number of tasks awaiting any signal. */
+	uint32_t waiting;
+
+	/* Signals that have been blocked in order to be read from the signal file descriptor. */
+	zend_bool blocked[CONCURRENT_SIGNAL_WATCHER_MAX];
+
+	/* Queues of task continuations indexed by signal number. */
+	concurrent_awaitable_queue queues[CONCURRENT_SIGNAL_WATCHER_MAX];
+};
+
+zend_bool concurrent_signal_watcher_register(concurrent_task *task, zend_long signo);
+void concurrent_signal_watcher_unregister(concurrent_task *task, zend_long signo);
+
+void concurrent_signal_watcher_shutdown();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
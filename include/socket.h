@@ -0,0 +1,59 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_SOCKET_H
+#define CONCURRENT_SOCKET_H
+
+#include "php.h"
+
+BEGIN_EXTERN_C()
+
+extern zend_class_entry *concurrent_socket_ce;
+
+typedef struct _concurrent_socket concurrent_socket;
+
+struct _concurrent_socket {
+	/* Socket PHP object handle. */
+	zend_object std;
+
+	/* Wrapped socket stream resource, keeps the stream open as long as the socket is used. */
+	zval stream;
+
+	/* Native (non-blocking) socket descriptor. */
+	int fd;
+
+	/* Receive buffer, reused until a read consumes all of it, the buffer is then handed off to PHP without copying. */
+	zend_string *buffer;
+
+	/* Offset and number of received bytes in the buffer that have not been read yet. */
+	size_t offset;
+	size_t length;
+
+	zend_bool closed;
+};
+
+void concurrent_socket_ce_register();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
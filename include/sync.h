@@ -0,0 +1,76 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_SYNC_H
+#define CONCURRENT_SYNC_H
+
+#include "php.h"
+#include "task.h"
+
+BEGIN_EXTERN_C()
+
+extern zend_class_entry *concurrent_mutex_ce;
+extern zend_class_entry *concurrent_semaphore_ce;
+extern zend_class_entry *concurrent_condition_ce;
+
+typedef struct _concurrent_mutex concurrent_mutex;
+typedef struct _concurrent_semaphore concurrent_semaphore;
+typedef struct _concurrent_condition concurrent_condition;
+
+struct _concurrent_mutex {
+	/* Mutex PHP object handle. */
+	zend_object std;
+
+	/* Task that owns the lock, NULL if the lock is owned by code running outside of a task. */
+	concurrent_task *owner;
+
+	/* Tasks waiting for the lock, ownership is handed to the first waiter on unlock. */
+	concurrent_task_wait_queue waiters;
+
+	zend_bool locked;
+};
+
+struct _concurrent_semaphore {
+	/* Semaphore PHP object handle. */
+	zend_object std;
+
+	/* Number of permits that can be acquired without waiting. */
+	zend_long permits;
+
+	/* Tasks waiting for a permit, a released permit is handed to the first waiter. */
+	concurrent_task_wait_queue waiters;
+};
+
+struct _concurrent_condition {
+	/* Condition PHP object handle. */
+	zend_object std;
+
+	/* Tasks waiting for a notification, waiter values point to the mutex passed to wait(). */
+	concurrent_task_wait_queue waiters;
+};
+
+void concurrent_sync_ce_register();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -25,6 +25,9 @@
 typedef void* concurrent_fiber_context;
 typedef struct _concurrent_context concurrent_context;
 typedef struct _concurrent_task_scheduler concurrent_task_scheduler;
+typedef struct _concurrent_task_deadline concurrent_task_deadline;
+typedef struct _concurrent_task_scheduler_tenant concurrent_task_scheduler_tenant;
+typedef struct _concurrent_task_local_slot concurrent_task_local_slot;
 
 BEGIN_EXTERN_C()
 
@@ -45,9 +48,15 @@ struct _concurrent_task {
 	/* Async execution context provided to the task. */
 	concurrent_context *context;
 
+	/* Deadline timer the task is registered with while it is suspended, NULL if the context has no deadline. */
+	concurrent_task_deadline *deadline;
+
 	/* Next task scheduled for execution. */
 	concurrent_task *next;
 
+	/* Tenant the task is scheduled as (resolved on enqueue), NULL unless the task is queued or being run. */
+	concurrent_task_scheduler_tenant *tenant;
+
 	/* Next operation to be performed by the scheduler, one of the CONCURRENT_TASK_OPERATION_* constants. */
 	zend_uchar operation;
 
@@ -57,8 +66,38 @@ struct _concurrent_task {
 	/* Return value of the task, may also be an error object, check status for outcome. */
 	zval result;
 
-	/* Linked list of registered continuation callbacks. */
-	concurrent_awaitable_cb *continuation;
+	/* Registered continuation callbacks, the first one is stored inline. */
+	concurrent_awaitable_queue continuation;
+
+	/* Values of task locals indexed by slot, allocated when the first local is set. */
+	concurrent_task_local_slot *locals;
+	uint32_t local_count;
+};
+
+typedef struct _concurrent_task_waiter concurrent_task_waiter;
+typedef struct _concurrent_task_wait_queue concurrent_task_wait_queue;
+
+struct _concurrent_task_waiter {
+	/* Suspended task waiting in the queue. */
+	concurrent_task *task;
+
+	/* Arbitrary value provided by the waiting task (like a value to be sent to a channel). */
+	zval *value;
+
+	/* Doubly linked list of waiters, waiters are usually allocated on the C stack of the suspended task. */
+	concurrent_task_waiter *prev;
+	concurrent_task_waiter *next;
+
+	/* Queue the waiter is currently linked into, NULL if the waiter is not queued. */
+	concurrent_task_wait_queue *queue;
+
+	/* Optional callback (receives the waiter) that is invoked instead of continuing the task. */
+	concurrent_awaitable_func func;
+};
+
+struct _concurrent_task_wait_queue {
+	concurrent_task_waiter *first;
+	concurrent_task_waiter *last;
 };
 
 extern const zend_uchar CONCURRENT_FIBER_TYPE_TASK;
@@ -71,6 +110,19 @@ concurrent_task *concurrent_task_object_create();
 
 void concurrent_task_start(concurrent_task *task);
 void concurrent_task_continue(concurrent_task *task);
+void concurrent_task_suspend(concurrent_task *task, zval *return_value, zend_execute_data *execute_data);
+void concurrent_task_continuation(void *obj, zval *result, zend_bool success);
+zend_bool concurrent_task_cancel(concurrent_task *task, zval *error);
+
+concurrent_task *concurrent_task_get_current();
+concurrent_task *concurrent_task_get_active();
+
+void concurrent_task_wait(concurrent_task_wait_queue *queue, concurrent_task_waiter *waiter, zval *return_value, zend_execute_data *execute_data);
+void concurrent_task_wait_queue_push(concurrent_task_wait_queue *queue, concurrent_task_waiter *waiter);
+concurrent_task_waiter *concurrent_task_wait_queue_shift(concurrent_task_wait_queue *queue);
+void concurrent_task_wait_queue_remove(concurrent_task_waiter *waiter);
+void concurrent_task_waiter_continue(concurrent_task_waiter *waiter, zval *result, zend_bool success);
+void concurrent_task_wait_queue_fail(concurrent_task_wait_queue *queue, const char *message);
 
 void concurrent_task_ce_register();
 
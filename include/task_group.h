@@ -0,0 +1,57 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_TASK_GROUP_H
+#define CONCURRENT_TASK_GROUP_H
+
+#include "php.h"
+#include "task.h"
+
+BEGIN_EXTERN_C()
+
+extern zend_class_entry *concurrent_task_group_ce;
+
+typedef struct _concurrent_task_group concurrent_task_group;
+
+struct _concurrent_task_group {
+	/* Task group PHP object handle. */
+	zend_object std;
+
+	/* Child tasks in spawn order, the group owns a reference to each child. */
+	HashTable children;
+
+	/* Number of child tasks that have not been completed yet. */
+	uint32_t pending;
+
+	/* Error raised by the first child that failed (or the cancellation error), UNDEF if no child has failed. */
+	zval error;
+
+	/* Tasks waiting for all children to complete. */
+	concurrent_task_wait_queue waiters;
+};
+
+void concurrent_task_group_ce_register();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,62 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_TASK_LOCAL_H
+#define CONCURRENT_TASK_LOCAL_H
+
+#include "php.h"
+#include "task.h"
+
+BEGIN_EXTERN_C()
+
+extern zend_class_entry *concurrent_task_local_ce;
+
+typedef struct _concurrent_task_local concurrent_task_local;
+
+struct _concurrent_task_local {
+	/* Task local PHP object handle. */
+	zend_object std;
+
+	/* Index of the slot in the local storage of each task. */
+	uint32_t slot;
+
+	/* Unique version of the local, values stored by a previous owner of the slot are ignored. */
+	uint32_t version;
+};
+
+struct _concurrent_task_local_slot {
+	/* Value of the local in the task. */
+	zval value;
+
+	/* Version of the local that stored the value, 0 if the slot has not been used yet. */
+	uint32_t version;
+};
+
+void concurrent_task_locals_destroy(concurrent_task *task);
+
+void concurrent_task_local_ce_register();
+void concurrent_task_local_shutdown();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
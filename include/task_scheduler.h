@@ -29,6 +29,8 @@ BEGIN_EXTERN_C()
 extern zend_class_entry *concurrent_task_scheduler_ce;
 
 typedef struct _concurrent_task_scheduler concurrent_task_scheduler;
+typedef struct _concurrent_task_deadline concurrent_task_deadline;
+typedef struct _concurrent_task_scheduler_tenant concurrent_task_scheduler_tenant;
 
 struct _concurrent_task_scheduler {
 	/* Task PHP object handle. */
@@ -43,12 +45,70 @@ struct _concurrent_task_scheduler {
 	/* Points to the last task to be run (needed to insert tasks into the run queue. */
 	concurrent_task *last;
 
+	/* Number of native waits that have been satisfied / not satisfied while busy-polling. */
+	size_t spin_hits;
+	size_t spin_misses;
+
+	/* Context variable (name or context key) that identifies the tenant of a task, UNDEF for FIFO scheduling. */
+	zval tenant_key;
+
+	/* Tenants indexed by name, allocated when the first tenant is created. */
+	HashTable *tenants;
+
+	/* Round-robin list of tenants that have tasks scheduled to run. */
+	concurrent_task_scheduler_tenant *active_first;
+	concurrent_task_scheduler_tenant *active_last;
+
+	/* Pending deadlines of suspended tasks run by the scheduler, sorted by expiration time. */
+	concurrent_task_deadline *deadlines;
+
 	zend_bool running;
 	zend_bool activate;
 };
 
+struct _concurrent_task_scheduler_tenant {
+	/* Name of the tenant (key in the tenant table of the scheduler). */
+	zend_string *name;
+
+	/* Tasks of the tenant that are scheduled to run. */
+	concurrent_task *first;
+	concurrent_task *last;
+
+	/* Next tenant in the round-robin list of tenants that have tasks scheduled to run. */
+	concurrent_task_scheduler_tenant *next;
+
+	/* Share of run time relative to other tenants, the tenant receives weight times the quantum per round. */
+	zend_long weight;
+
+	/* Run time (in microseconds) the tenant may use before the next tenant is served (deficit round-robin). */
+	zend_long deficit;
+
+	/* Number of scheduled tasks, number of task runs and accumulated run time in microseconds. */
+	size_t scheduled;
+	size_t runs;
+	zend_long run_time;
+
+	zend_bool active;
+};
+
+struct _concurrent_task_deadline {
+	/* Monotonic time (in microseconds) when the deadline expires. */
+	zend_long time;
+
+	/* Suspended tasks (not referenced) that inherited the deadline from their context, indexed by task ID. */
+	HashTable tasks;
+
+	/* Next pending deadline, deadlines are sorted by expiration time. */
+	concurrent_task_deadline *next;
+};
+
 concurrent_task_scheduler *concurrent_task_scheduler_get();
 
+zend_long concurrent_task_scheduler_now();
+
+void concurrent_task_scheduler_watch_deadline(concurrent_task *task);
+void concurrent_task_scheduler_unwatch_deadline(concurrent_task *task);
+
 zend_bool concurrent_task_scheduler_enqueue(concurrent_task *task);
 
 void concurrent_task_scheduler_run_loop(concurrent_task_scheduler *scheduler);
@@ -0,0 +1,58 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef CONCURRENT_THENABLE_H
+#define CONCURRENT_THENABLE_H
+
+#include "php.h"
+
+typedef struct _concurrent_task concurrent_task;
+
+BEGIN_EXTERN_C()
+
+extern zend_class_entry *concurrent_thenable_continuation_ce;
+
+typedef struct _concurrent_thenable_continuation concurrent_thenable_continuation;
+
+struct _concurrent_thenable_continuation {
+	/* Thenable continuation PHP object handle. */
+	zend_object std;
+
+	/* Suspended task, NULL before the task has been suspended and after it has been continued. */
+	concurrent_task *task;
+
+	/* Outcome of the thenable, uses the status constants of deferreds. */
+	zend_uchar status;
+	zval result;
+};
+
+void concurrent_thenable_register(zend_class_entry *ce);
+zend_bool concurrent_thenable_is_thenable(zend_class_entry *ce);
+void concurrent_thenable_await(concurrent_task *task, zval *thenable, zval *return_value, zend_execute_data *execute_data);
+
+void concurrent_thenable_ce_register();
+void concurrent_thenable_shutdown();
+
+END_EXTERN_C()
+
+#endif
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -38,8 +38,32 @@ static PHP_INI_MH(OnUpdateFiberStackSize)
 	return SUCCESS;
 }
 
+static PHP_INI_MH(OnUpdateSpinTime)
+{
+	OnUpdateLong(entry, new_value, mh_arg1, mh_arg2, mh_arg3, stage);
+
+	if (TASK_G(spin_time) < 0) {
+		TASK_G(spin_time) = 0;
+	}
+
+	return SUCCESS;
+}
+
+static PHP_INI_MH(OnUpdateContextDepth)
+{
+	OnUpdateLong(entry, new_value, mh_arg1, mh_arg2, mh_arg3, stage);
+
+	if (TASK_G(context_depth) < 0) {
+		TASK_G(context_depth) = 0;
+	}
+
+	return SUCCESS;
+}
+
 PHP_INI_BEGIN()
 	STD_PHP_INI_ENTRY("task.stack_size", "0", PHP_INI_SYSTEM, OnUpdateFiberStackSize, stack_size, zend_task_globals, task_globals)
+	STD_PHP_INI_ENTRY("task.spin_time", "0", PHP_INI_ALL, OnUpdateSpinTime, spin_time, zend_task_globals, task_globals)
+	STD_PHP_INI_ENTRY("task.context_depth", "32", PHP_INI_ALL, OnUpdateContextDepth, context_depth, zend_task_globals, task_globals)
 PHP_INI_END()
 
 
@@ -55,11 +79,22 @@ static PHP_GINIT_FUNCTION(task)
 PHP_MINIT_FUNCTION(task)
 {
 	concurrent_awaitable_ce_register();
+	concurrent_cancellation_ce_register();
+	concurrent_channel_ce_register();
 	concurrent_context_ce_register();
 	concurrent_deferred_ce_register();
 	concurrent_fiber_ce_register();
+#ifndef PHP_WIN32
+	concurrent_server_ce_register();
+	concurrent_socket_ce_register();
+	concurrent_stream_ce_register();
+#endif
+	concurrent_sync_ce_register();
 	concurrent_task_ce_register();
+	concurrent_task_group_ce_register();
+	concurrent_task_local_ce_register();
 	concurrent_task_scheduler_ce_register();
+	concurrent_thenable_ce_register();
 
 	REGISTER_INI_ENTRIES();
 
@@ -98,9 +133,22 @@ static PHP_RINIT_FUNCTION(task)
 
 static PHP_RSHUTDOWN_FUNCTION(task)
 {
+	concurrent_signal_watcher_shutdown();
 	concurrent_task_scheduler_shutdown();
 	concurrent_context_shutdown();
+	concurrent_deferred_shutdown();
 	concurrent_fiber_shutdown();
+	concurrent_io_watcher_shutdown();
+	concurrent_thenable_shutdown();
+
+	return SUCCESS;
+}
+
+/* Objects are freed after RSHUTDOWN, continuation nodes they release must not outlive the request. */
+static ZEND_MODULE_POST_ZEND_DEACTIVATE_D(task)
+{
+	concurrent_awaitable_shutdown();
+	concurrent_task_local_shutdown();
 
 	return SUCCESS;
 }
@@ -118,7 +166,7 @@ zend_module_entry task_module_entry = {
 	PHP_MODULE_GLOBALS(task),
 	PHP_GINIT(task),
 	NULL,
-	NULL,
+	ZEND_MODULE_POST_ZEND_DEACTIVATE_N(task),
 	STANDARD_MODULE_PROPERTIES_EX
 };
 
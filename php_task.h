@@ -20,11 +20,23 @@
 #define PHP_TASK_H
 
 #include "awaitable.h"
+#include "cancellation.h"
+#include "channel.h"
 #include "context.h"
 #include "deferred.h"
 #include "fiber.h"
+#include "hamt.h"
+#include "io_watcher.h"
+#include "server.h"
+#include "signal_watcher.h"
+#include "socket.h"
+#include "stream.h"
+#include "sync.h"
 #include "task.h"
+#include "task_group.h"
+#include "task_local.h"
 #include "task_scheduler.h"
+#include "thenable.h"
 
 extern zend_module_entry task_module_entry;
 #define phpext_task_ptr &task_module_entry
@@ -66,11 +78,57 @@ ZEND_BEGIN_MODULE_GLOBALS(task)
 	/* Default fiber C stack size. */
 	zend_long stack_size;
 
+	/* Time (in microseconds) to busy-poll native watchers before blocking in the native wait. */
+	zend_long spin_time;
+
+	/* Maximum number of context ancestors before derived contexts are flattened, 0 disables flattening. */
+	zend_long context_depth;
+
 	/* Error to be thrown into a fiber (will be populated by throw()). */
 	zval *error;
 
+	/* Linked list of active native I/O watchers. */
+	concurrent_io_watcher *io_watchers;
+	uint32_t io_watcher_count;
+
+	/* Watchers that are ready and wait for their callback to be invoked. */
+	concurrent_io_watcher *io_ready;
+
+	/* Reusable poll buffers, grown as needed. */
+	void *io_poll_fds;
+	concurrent_io_watcher **io_poll_watchers;
+	uint32_t io_poll_size;
+
+	/* Shared resolved awaitables of null, false and true (indexed by type), created on first use. */
+	concurrent_deferred_awaitable *deferred_values[3];
+
+	/* Set while continuations of a destroyed awaitable are failed, transform callbacks are skipped. */
+	zend_bool awaitable_disposing;
+
+	/* Fiber that runs an awaitable transform callback (on the stack of the resolving code), it must not be suspended. */
+	concurrent_fiber *transform_fiber;
+
+	/* Released continuation nodes, reused by awaitables with more than one waiter. */
+	concurrent_awaitable_cb *awaitable_cb_free;
+
+	/* Registered thenable classes (indexed by class name), allocated on first registration. */
+	HashTable *thenables;
+
+	/* Signal watcher, will be created when a task awaits a signal for the first time. */
+	concurrent_signal_watcher *signal_watcher;
+
 	size_t counter;
 
+	/* Last slot index that has been assigned to a context key. */
+	uint32_t context_key_slot;
+
+	/* Number of task local slots, released slots are reused by new task locals. */
+	uint32_t task_local_slots;
+	uint32_t task_local_version;
+	uint32_t *task_local_free;
+	uint32_t task_local_free_count;
+	uint32_t task_local_free_size;
+
 ZEND_END_MODULE_GLOBALS(task)
 
 TASK_API ZEND_EXTERN_MODULE_GLOBALS(task)
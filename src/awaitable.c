@@ -21,84 +21,202 @@
 zend_class_entry *concurrent_awaitable_ce;
 
 
-concurrent_awaitable_cb *concurrent_awaitable_create_continuation(void *obj, concurrent_awaitable_func func)
+static concurrent_awaitable_cb *concurrent_awaitable_node_alloc(concurrent_awaitable_queue *queue)
 {
-	concurrent_awaitable_cb *cont;
+	concurrent_awaitable_cb *node;
 
-	cont = emalloc(sizeof(concurrent_awaitable_cb));
+	if (queue->slot.func == NULL) {
+		return &queue->slot;
+	}
 
-	cont->object = obj;
-	cont->func = func;
-	cont->next = NULL;
+	node = TASK_G(awaitable_cb_free);
+
+	if (node == NULL) {
+		return emalloc(sizeof(concurrent_awaitable_cb));
+	}
+
+	TASK_G(awaitable_cb_free) = node->next;
 
-	return cont;
+	return node;
 }
 
-void concurrent_awaitable_append_continuation(concurrent_awaitable_cb *prev, void *obj, concurrent_awaitable_func func)
+static void concurrent_awaitable_node_release(concurrent_awaitable_queue *queue, concurrent_awaitable_cb *node)
+{
+	node->func = NULL;
+
+	if (node != &queue->slot) {
+		node->next = TASK_G(awaitable_cb_free);
+		TASK_G(awaitable_cb_free) = node;
+	}
+}
+
+void concurrent_awaitable_append_continuation(concurrent_awaitable_queue *queue, void *obj, concurrent_awaitable_func func)
 {
 	concurrent_awaitable_cb *cont;
 
-	ZEND_ASSERT(prev != NULL);
+	ZEND_ASSERT(func != NULL);
 
-	cont = emalloc(sizeof(concurrent_awaitable_cb));
+	cont = concurrent_awaitable_node_alloc(queue);
 
 	cont->object = obj;
 	cont->func = func;
 	cont->next = NULL;
 
-	prev->next = cont;
+	if (queue->last == NULL) {
+		queue->first = cont;
+	} else {
+		queue->last->next = cont;
+	}
+
+	queue->last = cont;
 }
 
-void concurrent_awaitable_trigger_continuation(concurrent_awaitable_cb **cont, zval *result, zend_bool success)
+/*
+ * Every continuation is unlinked and released before it is called, callbacks are free to register new continuations
+ * or to remove other continuations from the queue being triggered.
+ */
+void concurrent_awaitable_trigger_continuation(concurrent_awaitable_queue *queue, zval *result, zend_bool success)
 {
 	concurrent_awaitable_cb *current;
-	concurrent_awaitable_cb *next;
+	concurrent_awaitable_func func;
+	void *obj;
 
-	current = *cont;
+	while ((current = queue->first) != NULL) {
+		queue->first = current->next;
 
-	if (current != NULL) {
-		do {
-			next = current->next;
-			*cont = next;
+		if (queue->first == NULL) {
+			queue->last = NULL;
+		}
 
-			current->func(current->object, result, success);
+		obj = current->object;
+		func = current->func;
 
-			efree(current);
+		concurrent_awaitable_node_release(queue, current);
 
-			current = next;
-		} while (current != NULL);
+		func(obj, result, success);
 	}
-
-	*cont = NULL;
 }
 
-void concurrent_awaitable_dispose_continuation(concurrent_awaitable_cb **cont)
+/* Fails all continuations of an awaitable that is being destroyed, transform callbacks are not called while disposing. */
+void concurrent_awaitable_dispose_continuation(concurrent_awaitable_queue *queue)
 {
-	concurrent_awaitable_cb *current;
-	concurrent_awaitable_cb *next;
-	zval error;
+	zend_bool disposing;
 
-	current = *cont;
+	zval error;
 
-	if (current != NULL) {
+	if (queue->first != NULL) {
 		zend_throw_error(NULL, "Awaitable has been disposed before it was resolved");
-		ZVAL_OBJ(&error, EG(exception));
 
-		do {
-			next = current->next;
-			*cont = next;
+		// The thrown error is still referenced by EG(exception).
+		ZVAL_OBJ(&error, EG(exception));
+		Z_ADDREF(error);
 
-			current->func(current->object, &error, 0);
+		disposing = TASK_G(awaitable_disposing);
+		TASK_G(awaitable_disposing) = 1;
 
-			efree(current);
+		concurrent_awaitable_trigger_continuation(queue, &error, 0);
 
-			current = next;
-		} while (current != NULL);
+		TASK_G(awaitable_disposing) = disposing;
 
 		zval_ptr_dtor(&error);
 	}
+}
+
+/* Removes the first continuation matching the given object and callback, returns 0 if there is no such continuation. */
+zend_bool concurrent_awaitable_remove_continuation(concurrent_awaitable_queue *queue, void *obj, concurrent_awaitable_func func)
+{
+	concurrent_awaitable_cb *current;
+	concurrent_awaitable_cb *prev;
+
+	prev = NULL;
+
+	for (current = queue->first; current != NULL; current = current->next) {
+		if (current->object == obj && current->func == func) {
+			if (prev == NULL) {
+				queue->first = current->next;
+			} else {
+				prev->next = current->next;
+			}
+
+			if (queue->last == current) {
+				queue->last = prev;
+			}
+
+			concurrent_awaitable_node_release(queue, current);
+
+			return 1;
+		}
 
-	*cont = NULL;
+		prev = current;
+	}
+
+	return 0;
+}
+
+/*
+ * Registers a continuation with a task or deferred awaitable. Returns 0 without registering anything if the awaitable
+ * has already been resolved, result and success are populated with the outcome in this case.
+ */
+zend_bool concurrent_awaitable_register(zend_object *awaitable, void *obj, concurrent_awaitable_func func, zval **result, zend_bool *success)
+{
+	concurrent_awaitable_queue *queue;
+	concurrent_task *task;
+	concurrent_deferred *defer;
+	concurrent_deferred_awaitable *resolved;
+
+	if (awaitable->ce == concurrent_task_ce) {
+		task = (concurrent_task *) awaitable;
+
+		if (task->fiber.status == CONCURRENT_FIBER_STATUS_FINISHED || task->fiber.status == CONCURRENT_FIBER_STATUS_DEAD) {
+			*result = &task->result;
+			*success = (task->fiber.status == CONCURRENT_FIBER_STATUS_FINISHED);
+
+			return 0;
+		}
+
+		queue = &task->continuation;
+	} else {
+		ZEND_ASSERT(awaitable->ce == concurrent_deferred_awaitable_ce);
+
+		resolved = (concurrent_deferred_awaitable *) awaitable;
+		defer = resolved->defer;
+
+		if (defer == NULL) {
+			*result = &resolved->result;
+			*success = (resolved->status == CONCURRENT_DEFERRED_STATUS_RESOLVED);
+
+			return 0;
+		}
+
+		if (defer->status != CONCURRENT_DEFERRED_STATUS_PENDING) {
+			*result = &defer->result;
+			*success = (defer->status == CONCURRENT_DEFERRED_STATUS_RESOLVED);
+
+			return 0;
+		}
+
+		queue = &defer->continuation;
+	}
+
+	concurrent_awaitable_append_continuation(queue, obj, func);
+
+	return 1;
+}
+
+/* Removes a continuation that has been registered using concurrent_awaitable_register() but has not been triggered. */
+void concurrent_awaitable_unregister(zend_object *awaitable, void *obj, concurrent_awaitable_func func)
+{
+	concurrent_deferred *defer;
+
+	if (awaitable->ce == concurrent_task_ce) {
+		concurrent_awaitable_remove_continuation(&((concurrent_task *) awaitable)->continuation, obj, func);
+	} else {
+		defer = ((concurrent_deferred_awaitable *) awaitable)->defer;
+
+		if (defer != NULL) {
+			concurrent_awaitable_remove_continuation(&defer->continuation, obj, func);
+		}
+	}
 }
 
 static int concurrent_awaitable_implement_interface(zend_class_entry *interface, zend_class_entry *implementor)
@@ -122,7 +240,198 @@ static int concurrent_awaitable_implement_interface(zend_class_entry *interface,
 	return FAILURE;
 }
 
+static const zend_uchar CONCURRENT_AWAITABLE_TRANSFORM_MAP = 0;
+static const zend_uchar CONCURRENT_AWAITABLE_TRANSFORM_CATCH = 1;
+static const zend_uchar CONCURRENT_AWAITABLE_TRANSFORM_FINALLY = 2;
+
+typedef struct _concurrent_awaitable_transform {
+	/* Deferred that resolves the awaitable returned by the transform. */
+	concurrent_deferred *defer;
+
+	/* Context that was active when the transform was created, the callback is run within this context. */
+	concurrent_context *context;
+
+	zend_fcall_info fci;
+	zend_fcall_info_cache fcc;
+
+	zend_uchar type;
+} concurrent_awaitable_transform;
+
+static void concurrent_awaitable_adopt_continuation(void *obj, zval *result, zend_bool success)
+{
+	concurrent_deferred *defer;
+
+	defer = (concurrent_deferred *) obj;
+
+	if (success) {
+		concurrent_deferred_resolve(defer, result);
+	} else {
+		concurrent_deferred_fail(defer, result);
+	}
+
+	OBJ_RELEASE(&defer->std);
+}
+
+/* Resolves the deferred with the given value, awaitables are adopted instead of being used as value. */
+static void concurrent_awaitable_adopt(concurrent_deferred *defer, zval *val)
+{
+	zend_class_entry *ce;
+	zend_bool success;
+
+	if (Z_TYPE_P(val) == IS_OBJECT) {
+		ce = Z_OBJCE_P(val);
+
+		if (ce == concurrent_task_ce || ce == concurrent_deferred_awaitable_ce) {
+			if (concurrent_awaitable_register(Z_OBJ_P(val), defer, concurrent_awaitable_adopt_continuation, &val, &success)) {
+				GC_ADDREF(&defer->std);
+				return;
+			}
+
+			if (!success) {
+				concurrent_deferred_fail(defer, val);
+				return;
+			}
+		}
+	}
+
+	concurrent_deferred_resolve(defer, val);
+}
+
+/*
+ * Transforms are run on the stack of the code that resolves the source awaitable, no fiber is created. Callbacks that
+ * need to await can return an awaitable, the awaitable returned by the transform will adopt its outcome.
+ */
+static void concurrent_awaitable_transform_continuation(void *obj, zval *result, zend_bool success)
+{
+	concurrent_awaitable_transform *transform;
+	concurrent_context *prev;
+	concurrent_fiber *fiber;
+
+	zval retval;
+	zval error;
+
+	transform = (concurrent_awaitable_transform *) obj;
+
+	// Pass the outcome through if the callback does not apply, it cannot be called while the source is being disposed.
+	if ((success ? transform->type == CONCURRENT_AWAITABLE_TRANSFORM_CATCH : transform->type == CONCURRENT_AWAITABLE_TRANSFORM_MAP) || TASK_G(awaitable_disposing)) {
+		if (success) {
+			concurrent_deferred_resolve(transform->defer, result);
+		} else {
+			concurrent_deferred_fail(transform->defer, result);
+		}
+	} else {
+		ZVAL_UNDEF(&retval);
+
+		if (transform->type == CONCURRENT_AWAITABLE_TRANSFORM_FINALLY) {
+			transform->fci.param_count = 0;
+		} else {
+			transform->fci.params = result;
+			transform->fci.param_count = 1;
+		}
+
+		transform->fci.retval = &retval;
+		transform->fci.no_separation = 1;
+
+		prev = TASK_G(current_context);
+		TASK_G(current_context) = transform->context;
+
+		// The callback runs on the stack of the resolving code, the active task must not be suspended by the callback.
+		fiber = TASK_G(transform_fiber);
+		TASK_G(transform_fiber) = TASK_G(current_fiber);
+
+		zend_call_function(&transform->fci, &transform->fcc);
+
+		TASK_G(transform_fiber) = fiber;
+		TASK_G(current_context) = prev;
+
+		if (UNEXPECTED(EG(exception))) {
+			ZVAL_OBJ(&error, EG(exception));
+			EG(exception) = NULL;
+
+			concurrent_deferred_fail(transform->defer, &error);
+
+			zval_ptr_dtor(&error);
+		} else if (transform->type != CONCURRENT_AWAITABLE_TRANSFORM_FINALLY) {
+			concurrent_awaitable_adopt(transform->defer, &retval);
+		} else if (success) {
+			concurrent_deferred_resolve(transform->defer, result);
+		} else {
+			concurrent_deferred_fail(transform->defer, result);
+		}
+
+		zval_ptr_dtor(&retval);
+	}
+
+	OBJ_RELEASE(&transform->defer->std);
+	OBJ_RELEASE(&transform->context->std);
+
+	zval_ptr_dtor(&transform->fci.function_name);
+
+	efree(transform);
+}
+
+static void concurrent_awaitable_transform(INTERNAL_FUNCTION_PARAMETERS, zend_uchar type)
+{
+	concurrent_awaitable_transform *transform;
+	zend_fcall_info fci;
+	zend_fcall_info_cache fcc;
+	zend_bool success;
+
+	zval *result;
+	zval obj;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_FUNC_EX(fci, fcc, 1, 0)
+	ZEND_PARSE_PARAMETERS_END();
+
+	transform = emalloc(sizeof(concurrent_awaitable_transform));
+	transform->defer = concurrent_deferred_create();
+	transform->context = concurrent_context_get();
+	transform->fci = fci;
+	transform->fcc = fcc;
+	transform->type = type;
+
+	GC_ADDREF(&transform->context->std);
+	Z_TRY_ADDREF_P(&transform->fci.function_name);
+
+	concurrent_deferred_get_awaitable(transform->defer, &obj);
+
+	if (!concurrent_awaitable_register(Z_OBJ_P(getThis()), transform, concurrent_awaitable_transform_continuation, &result, &success)) {
+		concurrent_awaitable_transform_continuation(transform, result, success);
+	}
+
+	RETURN_ZVAL(&obj, 1, 1);
+}
+
+/* {{{ proto Awaitable Awaitable::map(callable $callback) */
+ZEND_METHOD(Awaitable, map)
+{
+	concurrent_awaitable_transform(INTERNAL_FUNCTION_PARAM_PASSTHRU, CONCURRENT_AWAITABLE_TRANSFORM_MAP);
+}
+/* }}} */
+
+/* {{{ proto Awaitable Awaitable::catch(callable $callback) */
+ZEND_METHOD(Awaitable, catch)
+{
+	concurrent_awaitable_transform(INTERNAL_FUNCTION_PARAM_PASSTHRU, CONCURRENT_AWAITABLE_TRANSFORM_CATCH);
+}
+/* }}} */
+
+/* {{{ proto Awaitable Awaitable::finally(callable $callback) */
+ZEND_METHOD(Awaitable, finally)
+{
+	concurrent_awaitable_transform(INTERNAL_FUNCTION_PARAM_PASSTHRU, CONCURRENT_AWAITABLE_TRANSFORM_FINALLY);
+}
+/* }}} */
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_awaitable_transform, 0, 1, Concurrent\\Awaitable, 0)
+	ZEND_ARG_CALLABLE_INFO(0, callback, 0)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry awaitable_functions[] = {
+	ZEND_ABSTRACT_ME(Awaitable, map, arginfo_awaitable_transform)
+	ZEND_ABSTRACT_ME(Awaitable, catch, arginfo_awaitable_transform)
+	ZEND_ABSTRACT_ME(Awaitable, finally, arginfo_awaitable_transform)
 	ZEND_FE_END
 };
 
@@ -136,6 +445,17 @@ void concurrent_awaitable_ce_register()
 	concurrent_awaitable_ce->interface_gets_implemented = concurrent_awaitable_implement_interface;
 }
 
+void concurrent_awaitable_shutdown()
+{
+	concurrent_awaitable_cb *node;
+
+	while ((node = TASK_G(awaitable_cb_free)) != NULL) {
+		TASK_G(awaitable_cb_free) = node->next;
+
+		efree(node);
+	}
+}
+
 
 /*
  * vim: sw=4 ts=4
@@ -0,0 +1,233 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+zend_class_entry *concurrent_cancellation_token_ce;
+zend_class_entry *concurrent_cancellation_exception_ce;
+
+static zend_object_handlers concurrent_cancellation_token_handlers;
+
+
+void concurrent_cancellation_create_exception(zval *error, const char *message, zval *previous)
+{
+	object_init_ex(error, concurrent_cancellation_exception_ce);
+	zend_update_property_string(zend_ce_exception, error, "message", sizeof("message")-1, message);
+
+	if (previous != NULL && Z_TYPE_P(previous) == IS_OBJECT) {
+		zend_update_property(zend_ce_exception, error, "previous", sizeof("previous")-1, previous);
+	}
+}
+
+/* Registers a task that is about to be started, tasks are cancelled right away if the token has been cancelled. */
+void concurrent_cancellation_token_attach(concurrent_cancellation_token *token, concurrent_task *task)
+{
+	if (Z_TYPE_P(&token->error) != IS_UNDEF) {
+		concurrent_task_cancel(task, &token->error);
+		return;
+	}
+
+	if (token->tasks == NULL) {
+		ALLOC_HASHTABLE(token->tasks);
+		zend_hash_init(token->tasks, 8, NULL, NULL, 0);
+	}
+
+	zend_hash_index_add_ptr(token->tasks, (zend_ulong) task->id, task);
+}
+
+void concurrent_cancellation_token_detach(concurrent_cancellation_token *token, concurrent_task *task)
+{
+	if (token->tasks != NULL) {
+		zend_hash_index_del(token->tasks, (zend_ulong) task->id);
+	}
+}
+
+static zend_object *concurrent_cancellation_token_object_create(zend_class_entry *ce)
+{
+	concurrent_cancellation_token *token;
+
+	token = emalloc(sizeof(concurrent_cancellation_token));
+	ZEND_SECURE_ZERO(token, sizeof(concurrent_cancellation_token));
+
+	zend_object_std_init(&token->std, ce);
+	token->std.handlers = &concurrent_cancellation_token_handlers;
+
+	ZVAL_UNDEF(&token->error);
+
+	return &token->std;
+}
+
+static void concurrent_cancellation_token_object_destroy(zend_object *object)
+{
+	concurrent_cancellation_token *token;
+
+	token = (concurrent_cancellation_token *) object;
+
+	if (token->tasks != NULL) {
+		zend_hash_destroy(token->tasks);
+		FREE_HASHTABLE(token->tasks);
+	}
+
+	zval_ptr_dtor(&token->error);
+
+	zend_object_std_dtor(&token->std);
+}
+
+ZEND_METHOD(CancellationToken, cancel)
+{
+	concurrent_cancellation_token *token;
+	concurrent_task **tasks;
+	concurrent_task *task;
+	uint32_t count;
+	uint32_t i;
+
+	zval *reason;
+
+	reason = NULL;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_OBJECT_OF_CLASS_EX(reason, zend_ce_throwable, 1, 0)
+	ZEND_PARSE_PARAMETERS_END();
+
+	token = (concurrent_cancellation_token *) Z_OBJ_P(getThis());
+
+	if (Z_TYPE_P(&token->error) != IS_UNDEF) {
+		return;
+	}
+
+	concurrent_cancellation_create_exception(&token->error, "Operation has been cancelled", reason);
+
+	if (token->tasks == NULL || zend_hash_num_elements(token->tasks) == 0) {
+		return;
+	}
+
+	// Cancelled tasks run userland code while being unwound, take a snapshot that keeps all tasks alive.
+	count = zend_hash_num_elements(token->tasks);
+	tasks = safe_emalloc(count, sizeof(concurrent_task *), 0);
+	i = 0;
+
+	ZEND_HASH_FOREACH_PTR(token->tasks, task) {
+		GC_ADDREF(&task->fiber.std);
+		tasks[i++] = task;
+	} ZEND_HASH_FOREACH_END();
+
+	zend_hash_clean(token->tasks);
+
+	// Running tasks cannot be unwound, they will be cancelled when they reach their next suspension point.
+	for (i = 0; i < count; i++) {
+		concurrent_task_cancel(tasks[i], &token->error);
+
+		OBJ_RELEASE(&tasks[i]->fiber.std);
+	}
+
+	efree(tasks);
+}
+
+ZEND_METHOD(CancellationToken, isCancelled)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	RETURN_BOOL(Z_TYPE_P(&((concurrent_cancellation_token *) Z_OBJ_P(getThis()))->error) != IS_UNDEF);
+}
+
+ZEND_METHOD(CancellationToken, throwIfCancelled)
+{
+	concurrent_cancellation_token *token;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	token = (concurrent_cancellation_token *) Z_OBJ_P(getThis());
+
+	if (Z_TYPE_P(&token->error) == IS_UNDEF) {
+		return;
+	}
+
+	Z_ADDREF_P(&token->error);
+
+	execute_data->opline--;
+	zend_throw_exception_internal(&token->error);
+	execute_data->opline++;
+}
+
+ZEND_METHOD(CancellationToken, __wakeup)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Unserialization of a cancellation token is not allowed");
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_cancellation_token_cancel, 0, 0, 0)
+	ZEND_ARG_OBJ_INFO(0, reason, Throwable, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_cancellation_token_is_cancelled, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_cancellation_token_throw_if_cancelled, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_cancellation_token_wakeup, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry cancellation_token_functions[] = {
+	ZEND_ME(CancellationToken, cancel, arginfo_cancellation_token_cancel, ZEND_ACC_PUBLIC)
+	ZEND_ME(CancellationToken, isCancelled, arginfo_cancellation_token_is_cancelled, ZEND_ACC_PUBLIC)
+	ZEND_ME(CancellationToken, throwIfCancelled, arginfo_cancellation_token_throw_if_cancelled, ZEND_ACC_PUBLIC)
+	ZEND_ME(CancellationToken, __wakeup, arginfo_cancellation_token_wakeup, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+static const zend_function_entry cancellation_exception_functions[] = {
+	ZEND_FE_END
+};
+
+
+void concurrent_cancellation_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\CancellationToken", cancellation_token_functions);
+	concurrent_cancellation_token_ce = zend_register_internal_class(&ce);
+	concurrent_cancellation_token_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_cancellation_token_ce->create_object = concurrent_cancellation_token_object_create;
+	concurrent_cancellation_token_ce->serialize = zend_class_serialize_deny;
+	concurrent_cancellation_token_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_cancellation_token_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_cancellation_token_handlers.free_obj = concurrent_cancellation_token_object_destroy;
+	concurrent_cancellation_token_handlers.clone_obj = NULL;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\CancellationException", cancellation_exception_functions);
+	concurrent_cancellation_exception_ce = zend_register_internal_class_ex(&ce, zend_ce_exception);
+	concurrent_cancellation_exception_ce->ce_flags |= ZEND_ACC_FINAL;
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,324 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+zend_class_entry *concurrent_channel_ce;
+
+static zend_object_handlers concurrent_channel_handlers;
+
+
+static zend_object *concurrent_channel_object_create(zend_class_entry *ce)
+{
+	concurrent_channel *channel;
+
+	channel = emalloc(sizeof(concurrent_channel));
+	ZEND_SECURE_ZERO(channel, sizeof(concurrent_channel));
+
+	zend_object_std_init(&channel->std, ce);
+	channel->std.handlers = &concurrent_channel_handlers;
+
+	return &channel->std;
+}
+
+static void concurrent_channel_object_destroy(zend_object *object)
+{
+	concurrent_channel *channel;
+
+	channel = (concurrent_channel *) object;
+
+	concurrent_task_wait_queue_fail(&channel->receivers, "Channel has been disposed");
+	concurrent_task_wait_queue_fail(&channel->senders, "Channel has been disposed");
+
+	while (channel->count > 0) {
+		zval_ptr_dtor(&channel->buffer[channel->head]);
+
+		channel->head = (channel->head + 1) % channel->capacity;
+		channel->count--;
+	}
+
+	if (channel->buffer != NULL) {
+		efree(channel->buffer);
+	}
+
+	zend_object_std_dtor(&channel->std);
+}
+
+/*
+ * Receives a buffered value or the value of a waiting sender without waiting, returns 0 if no value is available.
+ * Ownership of the received value is transferred to the given zval.
+ */
+zend_bool concurrent_channel_try_receive(concurrent_channel *channel, zval *value)
+{
+	concurrent_task_waiter *sender;
+
+	zval result;
+
+	if (channel->count > 0) {
+		// Move the value out of the buffer.
+		ZVAL_COPY_VALUE(value, &channel->buffer[channel->head]);
+
+		channel->head = (channel->head + 1) % channel->capacity;
+		channel->count--;
+
+		sender = concurrent_task_wait_queue_shift(&channel->senders);
+
+		if (sender != NULL) {
+			ZVAL_COPY(&channel->buffer[(channel->head + channel->count) % channel->capacity], sender->value);
+			channel->count++;
+
+			ZVAL_NULL(&result);
+			concurrent_task_continuation(sender->task, &result, 1);
+		}
+
+		return 1;
+	}
+
+	sender = concurrent_task_wait_queue_shift(&channel->senders);
+
+	if (sender != NULL) {
+		ZVAL_COPY(value, sender->value);
+
+		ZVAL_NULL(&result);
+		concurrent_task_continuation(sender->task, &result, 1);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+ZEND_METHOD(Channel, __construct)
+{
+	concurrent_channel *channel;
+	zend_long capacity;
+
+	capacity = 0;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(capacity)
+	ZEND_PARSE_PARAMETERS_END();
+
+	channel = (concurrent_channel *) Z_OBJ_P(getThis());
+
+	if (channel->buffer != NULL) {
+		zend_throw_error(NULL, "Channel must not be constructed more than once");
+		return;
+	}
+
+	if (capacity < 0 || (zend_ulong) capacity > UINT32_MAX) {
+		zend_throw_error(NULL, "Invalid channel capacity " ZEND_LONG_FMT, capacity);
+		return;
+	}
+
+	channel->capacity = (uint32_t) capacity;
+
+	if (channel->capacity > 0) {
+		channel->buffer = safe_emalloc(channel->capacity, sizeof(zval), 0);
+	}
+}
+
+/* {{{ proto void Channel::send($value) */
+ZEND_METHOD(Channel, send)
+{
+	concurrent_channel *channel;
+	concurrent_task_waiter *receiver;
+	concurrent_task_waiter waiter;
+
+	zval *val;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_ZVAL(val)
+	ZEND_PARSE_PARAMETERS_END();
+
+	channel = (concurrent_channel *) Z_OBJ_P(getThis());
+
+	if (channel->closed) {
+		zend_throw_error(NULL, "Cannot send a value into a closed channel");
+		return;
+	}
+
+	// Hand the value directly to a waiting receiver, this bypasses the buffer.
+	receiver = concurrent_task_wait_queue_shift(&channel->receivers);
+
+	if (receiver != NULL) {
+		concurrent_task_waiter_continue(receiver, val, 1);
+		return;
+	}
+
+	if (channel->count < channel->capacity) {
+		ZVAL_COPY(&channel->buffer[(channel->head + channel->count) % channel->capacity], val);
+		channel->count++;
+
+		return;
+	}
+
+	ZEND_SECURE_ZERO(&waiter, sizeof(concurrent_task_waiter));
+
+	waiter.task = concurrent_task_get_current();
+	waiter.value = val;
+
+	if (waiter.task == NULL) {
+		zend_throw_error(NULL, "Cannot wait for a channel receiver outside of a running task");
+		return;
+	}
+
+	// The value is referenced by the call frame and will be copied by the receiver.
+	concurrent_task_wait(&channel->senders, &waiter, NULL, execute_data);
+}
+/* }}} */
+
+/* {{{ proto mixed Channel::receive() */
+ZEND_METHOD(Channel, receive)
+{
+	concurrent_channel *channel;
+	concurrent_task_waiter waiter;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	channel = (concurrent_channel *) Z_OBJ_P(getThis());
+
+	if (concurrent_channel_try_receive(channel, return_value)) {
+		return;
+	}
+
+	if (channel->closed) {
+		zend_throw_error(NULL, "Cannot receive a value from a closed channel");
+		return;
+	}
+
+	ZEND_SECURE_ZERO(&waiter, sizeof(concurrent_task_waiter));
+
+	waiter.task = concurrent_task_get_current();
+
+	if (waiter.task == NULL) {
+		zend_throw_error(NULL, "Cannot wait for a channel sender outside of a running task");
+		return;
+	}
+
+	concurrent_task_wait(&channel->receivers, &waiter, return_value, execute_data);
+}
+/* }}} */
+
+ZEND_METHOD(Channel, close)
+{
+	concurrent_channel *channel;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	channel = (concurrent_channel *) Z_OBJ_P(getThis());
+
+	if (channel->closed) {
+		return;
+	}
+
+	channel->closed = 1;
+
+	// Buffered values can still be received, only tasks that would wait forever are failed.
+	concurrent_task_wait_queue_fail(&channel->receivers, "Channel has been closed");
+	concurrent_task_wait_queue_fail(&channel->senders, "Channel has been closed");
+}
+
+ZEND_METHOD(Channel, isClosed)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	RETURN_BOOL(((concurrent_channel *) Z_OBJ_P(getThis()))->closed);
+}
+
+ZEND_METHOD(Channel, count)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	RETURN_LONG(((concurrent_channel *) Z_OBJ_P(getThis()))->count);
+}
+
+ZEND_METHOD(Channel, __wakeup)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Unserialization of a channel is not allowed");
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_channel_ctor, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, capacity, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_channel_send, 0, 0, 1)
+	ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_channel_receive, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_channel_close, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_channel_is_closed, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_channel_count, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_channel_wakeup, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry channel_functions[] = {
+	ZEND_ME(Channel, __construct, arginfo_channel_ctor, ZEND_ACC_PUBLIC | ZEND_ACC_CTOR)
+	ZEND_ME(Channel, send, arginfo_channel_send, ZEND_ACC_PUBLIC)
+	ZEND_ME(Channel, receive, arginfo_channel_receive, ZEND_ACC_PUBLIC)
+	ZEND_ME(Channel, close, arginfo_channel_close, ZEND_ACC_PUBLIC)
+	ZEND_ME(Channel, isClosed, arginfo_channel_is_closed, ZEND_ACC_PUBLIC)
+	ZEND_ME(Channel, count, arginfo_channel_count, ZEND_ACC_PUBLIC)
+	ZEND_ME(Channel, __wakeup, arginfo_channel_wakeup, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+void concurrent_channel_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\Channel", channel_functions);
+	concurrent_channel_ce = zend_register_internal_class(&ce);
+	concurrent_channel_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_channel_ce->create_object = concurrent_channel_object_create;
+	concurrent_channel_ce->serialize = zend_class_serialize_deny;
+	concurrent_channel_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_channel_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_channel_handlers.free_obj = concurrent_channel_object_destroy;
+	concurrent_channel_handlers.clone_obj = NULL;
+
+	zend_class_implements(concurrent_channel_ce, 1, zend_ce_countable);
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
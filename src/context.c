@@ -27,116 +27,446 @@
 ZEND_DECLARE_MODULE_GLOBALS(task)
 
 zend_class_entry *concurrent_context_ce;
+zend_class_entry *concurrent_context_key_ce;
 
 static zend_object_handlers concurrent_context_handlers;
+static zend_object_handlers concurrent_context_key_handlers;
 
 
-concurrent_context *concurrent_context_get()
+typedef struct _concurrent_context_vars {
+	/* Persistent map, used once the number of variables exceeds the inline capacity. */
+	concurrent_hamt map;
+
+	/* Variables while they fit inline. */
+	uint32_t count;
+	concurrent_hamt_entry entries[CONCURRENT_CONTEXT_INLINE_VARS];
+} concurrent_context_vars;
+
+
+static zend_always_inline zend_bool concurrent_context_same_value(zval *a, zval *b)
 {
-	concurrent_context *context;
+	if (Z_TYPE_P(a) != Z_TYPE_P(b)) {
+		return 0;
+	}
 
-	context = TASK_G(current_context);
+	switch (Z_TYPE_P(a)) {
+	case IS_UNDEF:
+	case IS_NULL:
+	case IS_FALSE:
+	case IS_TRUE:
+		return 1;
+	case IS_LONG:
+		return Z_LVAL_P(a) == Z_LVAL_P(b);
+	case IS_DOUBLE:
+		return memcmp(&Z_DVAL_P(a), &Z_DVAL_P(b), sizeof(double)) == 0;
+	}
 
-	if (context != NULL) {
-		return context;
+	return Z_COUNTED_P(a) == Z_COUNTED_P(b);
+}
+
+static zend_always_inline concurrent_hamt_entry *concurrent_context_find_entry(concurrent_hamt_entry *entries, uint32_t count, zend_string *name)
+{
+	concurrent_hamt_entry *end;
+	zend_ulong hash;
+
+	hash = ZSTR_HASH(name);
+
+	for (end = entries + count; entries < end; entries++) {
+		if (entries->key == name || (ZSTR_H(entries->key) == hash && zend_string_equals(entries->key, name))) {
+			return entries;
+		}
 	}
 
-	context = TASK_G(context);
+	return NULL;
+}
 
-	if (context != NULL) {
-		return context;
+/* Returns the value of a variable set in the given context (ignoring parent contexts) or NULL. */
+static zend_always_inline zval *concurrent_context_find_var(concurrent_context *context, zend_string *name)
+{
+	concurrent_hamt_entry *entry;
+
+	if (context->vars.root != NULL) {
+		return concurrent_hamt_find(&context->vars, name);
 	}
 
-	context = emalloc(sizeof(concurrent_context));
-	ZEND_SECURE_ZERO(context, sizeof(concurrent_context));
+	entry = concurrent_context_find_entry(context->inline_vars, context->var_count, name);
 
-	zend_object_std_init(&context->std, concurrent_context_ce);
-	context->std.handlers = &concurrent_context_handlers;
+	return (entry == NULL) ? NULL : &entry->value;
+}
 
-	GC_ADDREF(&context->std);
+/* Initializes a set of variables that starts out with all variables of the given context. */
+static void concurrent_context_vars_init(concurrent_context_vars *vars, concurrent_context *context)
+{
+	uint32_t i;
 
-	TASK_G(context) = context;
+	vars->map.root = NULL;
+	vars->map.count = 0;
+	vars->count = 0;
 
-	return context;
+	if (context == NULL) {
+		return;
+	}
+
+	if (context->vars.root != NULL) {
+		concurrent_hamt_copy(&vars->map, &context->vars);
+		return;
+	}
+
+	for (i = 0; i < context->var_count; i++) {
+		vars->entries[i].key = zend_string_copy(context->inline_vars[i].key);
+		ZVAL_COPY(&vars->entries[i].value, &context->inline_vars[i].value);
+	}
+
+	vars->count = context->var_count;
 }
 
+static void concurrent_context_vars_set(concurrent_context_vars *vars, zend_string *name, zval *value)
+{
+	concurrent_hamt_entry *entry;
+	uint32_t i;
+
+	zval *prev;
+	zval tmp;
 
-concurrent_context *concurrent_context_object_create(HashTable *params)
+	if (vars->map.root == NULL) {
+		entry = concurrent_context_find_entry(vars->entries, vars->count, name);
+
+		if (entry != NULL) {
+			if (!concurrent_context_same_value(&entry->value, value)) {
+				ZVAL_COPY_VALUE(&tmp, &entry->value);
+				ZVAL_COPY(&entry->value, value);
+
+				zval_ptr_dtor(&tmp);
+			}
+
+			return;
+		}
+
+		if (vars->count < CONCURRENT_CONTEXT_INLINE_VARS) {
+			entry = &vars->entries[vars->count++];
+
+			entry->key = zend_string_copy(name);
+			ZVAL_COPY(&entry->value, value);
+
+			return;
+		}
+
+		// Move all variables into a persistent map once they do not fit inline anymore.
+		for (i = 0; i < vars->count; i++) {
+			concurrent_hamt_assign(&vars->map, vars->entries[i].key, &vars->entries[i].value);
+
+			zend_string_release(vars->entries[i].key);
+			zval_ptr_dtor(&vars->entries[i].value);
+		}
+
+		vars->count = 0;
+	} else {
+		prev = concurrent_hamt_find(&vars->map, name);
+
+		if (prev != NULL && concurrent_context_same_value(prev, value)) {
+			return;
+		}
+	}
+
+	concurrent_hamt_assign(&vars->map, name, value);
+}
+
+static void concurrent_context_vars_remove(concurrent_context_vars *vars, zend_string *name)
+{
+	concurrent_hamt_entry *entry;
+	concurrent_hamt map;
+
+	if (vars->map.root != NULL) {
+		concurrent_hamt_remove(&map, &vars->map, name);
+		concurrent_hamt_destroy(&vars->map);
+
+		vars->map = map;
+
+		return;
+	}
+
+	entry = concurrent_context_find_entry(vars->entries, vars->count, name);
+
+	if (entry != NULL) {
+		zend_string_release(entry->key);
+		zval_ptr_dtor(&entry->value);
+
+		vars->count--;
+
+		memmove(entry, entry + 1, (vars->entries + vars->count - entry) * sizeof(concurrent_hamt_entry));
+	}
+}
+
+static void concurrent_context_vars_assign(concurrent_context_vars *vars, HashTable *params)
 {
-	concurrent_context *context;
-	HashPosition pos;
 	zend_string *name;
 	zend_ulong index;
 
-	name = NULL;
+	zval *value;
+
+	ZEND_HASH_FOREACH_KEY_VAL_IND(params, index, name, value) {
+		if (name == NULL) {
+			name = zend_long_to_str((zend_long) index);
+		} else {
+			zend_string_addref(name);
+		}
+
+		ZVAL_DEREF(value);
+
+		concurrent_context_vars_set(vars, name, value);
+
+		zend_string_release(name);
+	} ZEND_HASH_FOREACH_END();
+}
+
+/* Creates a context that takes over the given variables, small contexts store them in the object allocation. */
+static concurrent_context *concurrent_context_alloc(concurrent_context_vars *vars)
+{
+	concurrent_context *context;
+	uint32_t count;
+	size_t size;
+
+	count = (vars == NULL) ? 0 : vars->count;
+	size = XtOffsetOf(concurrent_context, inline_vars) + count * sizeof(concurrent_hamt_entry);
 
-	context = emalloc(sizeof(concurrent_context));
-	ZEND_SECURE_ZERO(context, sizeof(concurrent_context));
+	context = emalloc(size);
+	ZEND_SECURE_ZERO(context, XtOffsetOf(concurrent_context, inline_vars));
 
 	zend_object_std_init(&context->std, concurrent_context_ce);
 	context->std.handlers = &concurrent_context_handlers;
 
 	GC_ADDREF(&context->std);
 
-	if (params != NULL) {
-		context->param_count = zend_hash_num_elements(params);
-
-		if (context->param_count == 1) {
-			zend_hash_internal_pointer_reset_ex(params, &pos);
-			zend_hash_get_current_key_ex(params, &name, &index, &pos);
+	if (vars != NULL) {
+		context->vars = vars->map;
+		context->var_count = count;
 
-			context->data.var.name = zend_string_copy(name);
-			ZVAL_COPY(&context->data.var.value, zend_hash_get_current_data_ex(params, &pos));
-		} else if (context->param_count > 1) {
-			context->data.params = zend_array_dup(params);
-		}
+		memcpy(context->inline_vars, vars->entries, count * sizeof(concurrent_hamt_entry));
 	}
 
 	return context;
 }
 
-static concurrent_context *concurrent_context_object_create_single_var(zend_string *name, zval *value)
+concurrent_context *concurrent_context_get()
 {
 	concurrent_context *context;
 
-	context = emalloc(sizeof(concurrent_context));
-	ZEND_SECURE_ZERO(context, sizeof(concurrent_context));
+	context = TASK_G(current_context);
 
-	zend_object_std_init(&context->std, concurrent_context_ce);
-	context->std.handlers = &concurrent_context_handlers;
+	if (context != NULL) {
+		return context;
+	}
 
-	GC_ADDREF(&context->std);
+	context = TASK_G(context);
+
+	if (context != NULL) {
+		return context;
+	}
 
-	context->param_count = 1;
+	context = concurrent_context_alloc(NULL);
 
-	context->data.var.name = zend_string_copy(name);
-	ZVAL_COPY(&context->data.var.value, value);
+	TASK_G(context) = context;
 
 	return context;
 }
 
+concurrent_context *concurrent_context_object_create(HashTable *params)
+{
+	concurrent_context_vars vars;
+
+	concurrent_context_vars_init(&vars, NULL);
+
+	if (params != NULL) {
+		concurrent_context_vars_assign(&vars, params);
+	}
+
+	return concurrent_context_alloc(&vars);
+}
+
+static void concurrent_context_set_token(concurrent_context *context, concurrent_cancellation_token *token)
+{
+	context->token = token;
+
+	if (token != NULL) {
+		GC_ADDREF(&token->std);
+	}
+}
+
+/*
+ * Contexts derived from a context at the maximum depth copy all variables of their ancestors (except the root context)
+ * and become direct children of the root context. This bounds both the cost of lookups that miss and the number of
+ * ancestors kept alive by long chains of inherited contexts.
+ */
+static void concurrent_context_flatten(concurrent_context *context, concurrent_context *parent)
+{
+	concurrent_hamt vars;
+	uint32_t i;
+
+	// Flattened contexts store their variables in a persistent map, inline variables are moved into the map.
+	for (i = 0; i < context->var_count; i++) {
+		concurrent_hamt_assign(&context->vars, context->inline_vars[i].key, &context->inline_vars[i].value);
+
+		zend_string_release(context->inline_vars[i].key);
+		zval_ptr_dtor(&context->inline_vars[i].value);
+	}
+
+	context->var_count = 0;
+
+	while (parent->parent != NULL) {
+		if (parent->vars.root != NULL) {
+			concurrent_hamt_merge(&vars, &context->vars, &parent->vars);
+			concurrent_hamt_destroy(&context->vars);
+
+			context->vars = vars;
+		} else {
+			for (i = 0; i < parent->var_count; i++) {
+				if (concurrent_hamt_find(&context->vars, parent->inline_vars[i].key) == NULL) {
+					concurrent_hamt_assign(&context->vars, parent->inline_vars[i].key, &parent->inline_vars[i].value);
+				}
+			}
+		}
+
+		parent = parent->parent;
+	}
+
+	context->parent = parent;
+	context->depth = 1;
+
+	GC_ADDREF(&parent->std);
+}
+
+static void concurrent_context_set_parent(concurrent_context *context, concurrent_context *parent)
+{
+	if (parent == NULL) {
+		return;
+	}
+
+	if (TASK_G(context_depth) > 0 && parent->depth >= TASK_G(context_depth)) {
+		concurrent_context_flatten(context, parent);
+		return;
+	}
+
+	context->parent = parent;
+	context->depth = parent->depth + 1;
+
+	GC_ADDREF(&parent->std);
+}
 
 static void concurrent_context_object_destroy(zend_object *object)
 {
 	concurrent_context *context;
+	uint32_t i;
 
 	context = (concurrent_context *) object;
 
-	if (context->param_count == 1) {
-		zend_string_release(context->data.var.name);
-		zval_ptr_dtor(&context->data.var.value);
-	} else if (context->param_count > 1 && context->data.params != NULL) {
-		zend_hash_destroy(context->data.params);
-		FREE_HASHTABLE(context->data.params);
+	for (i = 0; i < context->var_count; i++) {
+		zend_string_release(context->inline_vars[i].key);
+		zval_ptr_dtor(&context->inline_vars[i].value);
+	}
+
+	concurrent_hamt_destroy(&context->vars);
+	concurrent_hamt_destroy(&context->keys);
+
+	if (context->cache != NULL) {
+		efree(context->cache);
 	}
 
 	if (context->parent != NULL) {
 		OBJ_RELEASE(&context->parent->std);
 	}
 
+	if (context->token != NULL) {
+		OBJ_RELEASE(&context->token->std);
+	}
+
 	zend_object_std_dtor(&context->std);
 }
 
+/* Returns the name of a context variable or NULL on error, context keys resolve to the name of their slot. */
+static zend_string *concurrent_context_var_name(zval *var, zend_bool *keyed)
+{
+	zend_string *name;
+
+	if (Z_TYPE_P(var) == IS_OBJECT && Z_OBJCE_P(var) == concurrent_context_key_ce) {
+		*keyed = 1;
+		name = ((concurrent_context_key *) Z_OBJ_P(var))->slot;
+
+		if (UNEXPECTED(name == NULL)) {
+			zend_throw_error(NULL, "Context key has not been initialized");
+		}
+
+		return name;
+	}
+
+	*keyed = 0;
+
+	if (Z_TYPE_P(var) == IS_STRING) {
+		return Z_STR_P(var);
+	}
+
+	if (!zend_parse_arg_str_weak(var, &name)) {
+		zend_type_error("Context variable must be a string or a %s, %s given", ZSTR_VAL(concurrent_context_key_ce->name), zend_zval_type_name(var));
+		return NULL;
+	}
+
+	return name;
+}
+
+static zval *concurrent_context_lookup_var(concurrent_context *context, zend_string *name)
+{
+	zval *val;
+
+	do {
+		val = concurrent_context_find_var(context, name);
+
+		if (val != NULL) {
+			return val;
+		}
+
+		context = context->parent;
+	} while (context != NULL);
+
+	return NULL;
+}
+
+/*
+ * Contexts and their parents are immutable, cached results (including misses) never need to be invalidated. Only
+ * interned names are cached because they live until the end of the request and can be compared by pointer.
+ */
+zval *concurrent_context_lookup(concurrent_context *context, zval *var)
+{
+	concurrent_context_cache_entry *entry;
+	zend_string *name;
+	zend_bool keyed;
+
+	name = concurrent_context_var_name(var, &keyed);
+
+	if (name == NULL) {
+		return NULL;
+	}
+
+	if (keyed) {
+		return concurrent_hamt_find(&context->keys, name);
+	}
+
+	if (!ZSTR_IS_INTERNED(name)) {
+		return concurrent_context_lookup_var(context, name);
+	}
+
+	if (context->cache == NULL) {
+		context->cache = ecalloc(CONCURRENT_CONTEXT_CACHE_SIZE, sizeof(concurrent_context_cache_entry));
+	}
+
+	entry = &context->cache[ZSTR_HASH(name) & (CONCURRENT_CONTEXT_CACHE_SIZE - 1)];
+
+	if (entry->key != name) {
+		entry->key = name;
+		entry->value = concurrent_context_lookup_var(context, name);
+	}
+
+	return entry->value;
+}
+
 ZEND_METHOD(Context, __construct)
 {
 	ZEND_PARSE_PARAMETERS_NONE();
@@ -146,84 +476,61 @@ ZEND_METHOD(Context, __construct)
 
 ZEND_METHOD(Context, get)
 {
-	concurrent_context *context;
-	zend_string *key;
-
+	zval *var;
 	zval *val;
 
 	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
-		Z_PARAM_ZVAL(val)
+		Z_PARAM_ZVAL(var)
 	ZEND_PARSE_PARAMETERS_END();
 
-	key = Z_STR_P(val);
-	ZSTR_HASH(key);
+	val = concurrent_context_lookup((concurrent_context *) Z_OBJ_P(getThis()), var);
 
-	context = (concurrent_context *) Z_OBJ_P(getThis());
-
-	do {
-		if (context->param_count == 1) {
-			if (zend_string_equals(key, context->data.var.name)) {
-				RETURN_ZVAL(&context->data.var.value, 1, 0);
-			}
-		} else if (context->param_count > 1) {
-			if (zend_hash_exists_ind(context->data.params, key)) {
-				RETURN_ZVAL(zend_hash_find_ex_ind(context->data.params, key, 1), 1, 0);
-			}
-		}
-
-		context = context->parent;
-	} while (context != NULL);
+	if (val != NULL) {
+		RETURN_ZVAL(val, 1, 0);
+	}
 }
 
 ZEND_METHOD(Context, with)
 {
 	concurrent_context *context;
 	concurrent_context *current;
-	zend_string *str;
+	concurrent_context_vars vars;
+	zend_string *name;
+	zend_bool keyed;
 
-	zval *key;
+	zval *var;
 	zval *value;
 	zval obj;
 
 	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 2, 2)
-		Z_PARAM_ZVAL(key)
+		Z_PARAM_ZVAL(var)
 		Z_PARAM_ZVAL(value)
 	ZEND_PARSE_PARAMETERS_END();
 
 	current = (concurrent_context *) Z_OBJ_P(getThis());
-	str = Z_STR_P(key);
+	name = concurrent_context_var_name(var, &keyed);
 
-	if (current->param_count == 0) {
-		context = concurrent_context_object_create_single_var(str, value);
-	} else if (current->param_count == 1 && zend_string_equals(str, current->data.var.name)) {
-		if (zend_string_equals(str, current->data.var.name)) {
-			context = concurrent_context_object_create_single_var(str, value);
-		} else {
-			context = concurrent_context_object_create(NULL);
-			context->param_count = 2;
+	if (name == NULL) {
+		return;
+	}
 
-			ALLOC_HASHTABLE(context->data.params);
-			zend_hash_init(context->data.params, 0, NULL, ZVAL_PTR_DTOR, 0);
+	concurrent_context_vars_init(&vars, current);
 
-			zend_hash_add(context->data.params, current->data.var.name, &current->data.var.value);
-			zend_hash_add(context->data.params, str, value);
-		}
+	if (keyed) {
+		context = concurrent_context_alloc(&vars);
+		concurrent_hamt_set(&context->keys, &current->keys, name, value);
 	} else {
-		context = concurrent_context_object_create(current->data.params);
+		concurrent_context_vars_set(&vars, name, value);
 
-		if (zend_hash_exists_ind(context->data.params, str)) {
-			zend_hash_update_ind(context->data.params, str, value);
-		} else {
-			zend_hash_add(context->data.params, str, value);
-			context->param_count++;
-		}
+		context = concurrent_context_alloc(&vars);
+		concurrent_hamt_copy(&context->keys, &current->keys);
 	}
 
-	context->parent = current->parent;
+	concurrent_context_set_parent(context, current->parent);
 
-	if (context->parent != NULL) {
-		GC_ADDREF(&context->parent->std);
-	}
+	concurrent_context_set_token(context, current->token);
+
+	context->deadline = current->deadline;
 
 	ZVAL_OBJ(&obj, &context->std);
 
@@ -234,56 +541,182 @@ ZEND_METHOD(Context, without)
 {
 	concurrent_context *context;
 	concurrent_context *current;
-	HashPosition pos;
-	zend_string *str;
-	zend_ulong index;
+	concurrent_context_vars vars;
+	zend_string *name;
+	zend_bool keyed;
 
-	zval *key;
+	zval *var;
 	zval obj;
 
 	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
-		Z_PARAM_ZVAL(key)
+		Z_PARAM_ZVAL(var)
 	ZEND_PARSE_PARAMETERS_END();
 
 	current = (concurrent_context *) Z_OBJ_P(getThis());
+	name = concurrent_context_var_name(var, &keyed);
 
-	str = Z_STR_P(key);
+	if (name == NULL) {
+		return;
+	}
 
-	if (current->param_count == 1) {
-		if (zend_string_equals(str, current->data.var.name)) {
-			context = concurrent_context_object_create(NULL);
-		} else {
-			context = concurrent_context_object_create_single_var(current->data.var.name, &current->data.var.value);
-		}
+	concurrent_context_vars_init(&vars, current);
+
+	if (keyed) {
+		context = concurrent_context_alloc(&vars);
+		concurrent_hamt_remove(&context->keys, &current->keys, name);
 	} else {
-		context = concurrent_context_object_create(current->data.params);
+		concurrent_context_vars_remove(&vars, name);
 
-		if (context->param_count > 1 && zend_hash_exists_ind(context->data.params, str)) {
-			context->param_count--;
+		context = concurrent_context_alloc(&vars);
+		concurrent_hamt_copy(&context->keys, &current->keys);
+	}
 
-			if (context->param_count == 1) {
-				zend_hash_internal_pointer_reset_ex(context->data.params, &pos);
-				zend_hash_get_current_key_ex(context->data.params, &str, &index, &pos);
+	concurrent_context_set_parent(context, current->parent);
 
-				context->data.var.name = zend_string_copy(str);
-				ZVAL_COPY(&context->data.var.value, zend_hash_get_current_data_ex(context->data.params, &pos));
-			} else {
-				zend_hash_del_ind(context->data.params, str);
-			}
-		}
-	}
+	concurrent_context_set_token(context, current->token);
 
-	context->parent = current->parent;
+	context->deadline = current->deadline;
 
-	if (context->parent != NULL) {
-		GC_ADDREF(&context->parent->std);
+	ZVAL_OBJ(&obj, &context->std);
+
+	RETURN_ZVAL(&obj, 1, 1);
+}
+
+ZEND_METHOD(Context, withMany)
+{
+	concurrent_context *context;
+	concurrent_context *current;
+	concurrent_context_vars vars;
+	HashTable *params;
+
+	zval obj;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_ARRAY_HT(params)
+	ZEND_PARSE_PARAMETERS_END();
+
+	current = (concurrent_context *) Z_OBJ_P(getThis());
+
+	concurrent_context_vars_init(&vars, current);
+	concurrent_context_vars_assign(&vars, params);
+
+	context = concurrent_context_alloc(&vars);
+
+	concurrent_hamt_copy(&context->keys, &current->keys);
+	concurrent_context_set_parent(context, current->parent);
+	concurrent_context_set_token(context, current->token);
+
+	context->deadline = current->deadline;
+
+	ZVAL_OBJ(&obj, &context->std);
+
+	RETURN_ZVAL(&obj, 1, 1);
+}
+
+ZEND_METHOD(Context, withCancellationToken)
+{
+	concurrent_context *context;
+	concurrent_context *current;
+
+	zval *token;
+	zval obj;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_OBJECT_OF_CLASS(token, concurrent_cancellation_token_ce)
+	ZEND_PARSE_PARAMETERS_END();
+
+	current = (concurrent_context *) Z_OBJ_P(getThis());
+
+	context = concurrent_context_alloc(NULL);
+	concurrent_context_set_parent(context, current);
+
+	concurrent_hamt_copy(&context->keys, &current->keys);
+
+	concurrent_context_set_token(context, (concurrent_cancellation_token *) Z_OBJ_P(token));
+
+	context->deadline = current->deadline;
+
+	ZVAL_OBJ(&obj, &context->std);
+
+	RETURN_ZVAL(&obj, 1, 1);
+}
+
+ZEND_METHOD(Context, withDeadline)
+{
+	concurrent_context *context;
+	concurrent_context *current;
+	concurrent_context_vars vars;
+	zend_long timeout;
+	zend_long deadline;
+
+	zval obj;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_LONG(timeout)
+	ZEND_PARSE_PARAMETERS_END();
+
+	current = (concurrent_context *) Z_OBJ_P(getThis());
+
+	deadline = concurrent_task_scheduler_now();
+	deadline += MIN(MAX(timeout, 0), (ZEND_LONG_MAX - deadline) / 1000) * 1000;
+
+	// Derived contexts can only shorten the deadline they inherit.
+	if (current->deadline != 0 && current->deadline < deadline) {
+		deadline = current->deadline;
 	}
 
+	concurrent_context_vars_init(&vars, current);
+
+	context = concurrent_context_alloc(&vars);
+
+	concurrent_hamt_copy(&context->keys, &current->keys);
+
+	concurrent_context_set_parent(context, current->parent);
+	concurrent_context_set_token(context, current->token);
+
+	context->deadline = deadline;
+
 	ZVAL_OBJ(&obj, &context->std);
 
 	RETURN_ZVAL(&obj, 1, 1);
 }
 
+ZEND_METHOD(Context, getDeadline)
+{
+	concurrent_context *context;
+	zend_long remaining;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	context = (concurrent_context *) Z_OBJ_P(getThis());
+
+	if (context->deadline == 0) {
+		return;
+	}
+
+	remaining = context->deadline - concurrent_task_scheduler_now();
+
+	RETURN_LONG((remaining > 0) ? (remaining + 999) / 1000 : 0);
+}
+
+ZEND_METHOD(Context, getCancellationToken)
+{
+	concurrent_context *context;
+	zval obj;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	context = (concurrent_context *) Z_OBJ_P(getThis());
+
+	if (context->token == NULL) {
+		return;
+	}
+
+	ZVAL_OBJ(&obj, &context->token->std);
+
+	RETURN_ZVAL(&obj, 1, 0);
+}
+
 ZEND_METHOD(Context, run)
 {
 	concurrent_context *context;
@@ -293,9 +726,10 @@ ZEND_METHOD(Context, run)
 	uint32_t param_count;
 
 	zval *params;
-	zval result;
+	zval ref;
 
 	params = NULL;
+	param_count = 0;
 
 	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, -1)
 		Z_PARAM_FUNC_EX(fci, fcc, 1, 0)
@@ -305,50 +739,42 @@ ZEND_METHOD(Context, run)
 
 	context = (concurrent_context *) Z_OBJ_P(getThis());
 
+	/* Arguments are passed from the VM stack of the call and the result is written directly into return_value. */
 	fci.params = params;
 	fci.param_count = param_count;
-	fci.retval = &result;
+	fci.retval = return_value;
 	fci.no_separation = 1;
 
 	prev = TASK_G(current_context);
 	TASK_G(current_context) = context;
 
+	/* Exceptions do not unwind the C stack, the previous context is restored before they reach the caller. */
 	zend_call_function(&fci, &fcc);
 
 	TASK_G(current_context) = prev;
 
-	RETURN_ZVAL(&result, 1, 1);
+	if (UNEXPECTED(Z_ISREF_P(return_value))) {
+		ZVAL_COPY_VALUE(&ref, return_value);
+		ZVAL_COPY(return_value, Z_REFVAL(ref));
+
+		zval_ptr_dtor(&ref);
+	}
 }
 
 ZEND_METHOD(Context, var)
 {
-	concurrent_context *context;
-	zend_string *key;
-
+	zval *var;
 	zval *val;
 
 	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
-		Z_PARAM_ZVAL(val)
+		Z_PARAM_ZVAL(var)
 	ZEND_PARSE_PARAMETERS_END();
 
-	key = Z_STR_P(val);
-	ZSTR_HASH(key);
-
-	context = concurrent_context_get();
-
-	do {
-		if (context->param_count == 1) {
-			if (zend_string_equals(key, context->data.var.name)) {
-				RETURN_ZVAL(&context->data.var.value, 1, 0);
-			}
-		} else if (context->param_count > 1) {
-			if (zend_hash_exists_ind(context->data.params, key)) {
-				RETURN_ZVAL(zend_hash_find_ex_ind(context->data.params, key, 1), 1, 0);
-			}
-		}
+	val = concurrent_context_lookup(concurrent_context_get(), var);
 
-		context = context->parent;
-	} while (context != NULL);
+	if (val != NULL) {
+		RETURN_ZVAL(val, 1, 0);
+	}
 }
 
 ZEND_METHOD(Context, current)
@@ -386,9 +812,13 @@ ZEND_METHOD(Context, inherit)
 	}
 
 	context = concurrent_context_object_create(table);
-	context->parent = current;
+	concurrent_context_set_parent(context, current);
+
+	concurrent_hamt_copy(&context->keys, &current->keys);
+
+	concurrent_context_set_token(context, current->token);
 
-	GC_ADDREF(&context->parent->std);
+	context->deadline = current->deadline;
 
 	ZVAL_OBJ(&obj, &context->std);
 
@@ -423,29 +853,135 @@ ZEND_METHOD(Context, background)
 	}
 
 	context = concurrent_context_object_create(table);
-	context->parent = current;
+	concurrent_context_set_parent(context, current);
 
-	GC_ADDREF(&current->std);
+	concurrent_hamt_copy(&context->keys, &current->keys);
 
 	ZVAL_OBJ(&obj, &context->std);
 
 	RETURN_ZVAL(&obj, 1, 1);
 }
 
+static zend_object *concurrent_context_key_object_create(zend_class_entry *ce)
+{
+	concurrent_context_key *key;
+
+	key = emalloc(sizeof(concurrent_context_key));
+	ZEND_SECURE_ZERO(key, sizeof(concurrent_context_key));
+
+	zend_object_std_init(&key->std, ce);
+	key->std.handlers = &concurrent_context_key_handlers;
+
+	return &key->std;
+}
+
+static void concurrent_context_key_object_destroy(zend_object *object)
+{
+	concurrent_context_key *key;
+
+	key = (concurrent_context_key *) object;
+
+	if (key->slot != NULL) {
+		zend_string_release(key->slot);
+	}
+
+	if (key->description != NULL) {
+		zend_string_release(key->description);
+	}
+
+	zend_object_std_dtor(&key->std);
+}
+
+ZEND_METHOD(ContextKey, __construct)
+{
+	concurrent_context_key *key;
+	zend_string *description;
+	uint32_t slot;
+
+	description = NULL;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_STR(description)
+	ZEND_PARSE_PARAMETERS_END();
+
+	key = (concurrent_context_key *) Z_OBJ_P(getThis());
+
+	if (key->slot != NULL) {
+		zend_throw_error(NULL, "Context key has already been initialized");
+		return;
+	}
+
+	slot = ++TASK_G(context_key_slot);
+
+	// Slot names are unique, using the slot index as hash spreads consecutive keys over distinct trie slots.
+	key->slot = zend_strpprintf(0, "#%u", slot);
+	ZSTR_H(key->slot) = (zend_ulong) slot;
+
+	key->description = (description == NULL) ? ZSTR_EMPTY_ALLOC() : zend_string_copy(description);
+}
+
+ZEND_METHOD(ContextKey, getDescription)
+{
+	concurrent_context_key *key;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	key = (concurrent_context_key *) Z_OBJ_P(getThis());
+
+	if (key->description == NULL) {
+		RETURN_EMPTY_STRING();
+	}
+
+	RETURN_STR_COPY(key->description);
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_context_key_ctor, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, description, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_context_key_get_description, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry context_key_functions[] = {
+	ZEND_ME(ContextKey, __construct, arginfo_context_key_ctor, ZEND_ACC_PUBLIC | ZEND_ACC_CTOR)
+	ZEND_ME(ContextKey, getDescription, arginfo_context_key_get_description, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
 ZEND_BEGIN_ARG_INFO(arginfo_context_ctor, 0)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_context_get, 0, 0, 1)
-	ZEND_ARG_TYPE_INFO(0, var, IS_STRING, 0)
+	ZEND_ARG_INFO(0, var)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_context_with, 0, 2, Concurrent\\Context, 0)
-	ZEND_ARG_TYPE_INFO(0, var, IS_STRING, 0)
+	ZEND_ARG_INFO(0, var)
 	ZEND_ARG_INFO(0, value)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_context_without, 0, 1, Concurrent\\Context, 0)
-	ZEND_ARG_TYPE_INFO(0, var, IS_STRING, 0)
+	ZEND_ARG_INFO(0, var)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_context_with_many, 0, 1, Concurrent\\Context, 0)
+	ZEND_ARG_ARRAY_INFO(0, vars, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_context_with_cancellation_token, 0, 1, Concurrent\\Context, 0)
+	ZEND_ARG_OBJ_INFO(0, token, Concurrent\\CancellationToken, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_context_with_deadline, 0, 1, Concurrent\\Context, 0)
+	ZEND_ARG_TYPE_INFO(0, milliseconds, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_context_get_deadline, 0, 0, IS_LONG, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_context_get_cancellation_token, 0, 0, Concurrent\\CancellationToken, 1)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_context_run, 0, 0, 1)
@@ -454,7 +990,7 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_context_run, 0, 0, 1)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_context_var, 0, 0, 1)
-	ZEND_ARG_TYPE_INFO(0, var, IS_STRING, 0)
+	ZEND_ARG_INFO(0, var)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_context_current, 0, 0, Concurrent\\Context, 0)
@@ -473,6 +1009,11 @@ static const zend_function_entry task_context_functions[] = {
 	ZEND_ME(Context, get, arginfo_context_get, ZEND_ACC_PUBLIC)
 	ZEND_ME(Context, with, arginfo_context_with, ZEND_ACC_PUBLIC)
 	ZEND_ME(Context, without, arginfo_context_without, ZEND_ACC_PUBLIC)
+	ZEND_ME(Context, withMany, arginfo_context_with_many, ZEND_ACC_PUBLIC)
+	ZEND_ME(Context, withCancellationToken, arginfo_context_with_cancellation_token, ZEND_ACC_PUBLIC)
+	ZEND_ME(Context, getCancellationToken, arginfo_context_get_cancellation_token, ZEND_ACC_PUBLIC)
+	ZEND_ME(Context, withDeadline, arginfo_context_with_deadline, ZEND_ACC_PUBLIC)
+	ZEND_ME(Context, getDeadline, arginfo_context_get_deadline, ZEND_ACC_PUBLIC)
 	ZEND_ME(Context, run, arginfo_context_run, ZEND_ACC_PUBLIC)
 	ZEND_ME(Context, var, arginfo_context_var, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
 	ZEND_ME(Context, current, arginfo_context_current, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
@@ -495,6 +1036,17 @@ void concurrent_context_ce_register()
 	memcpy(&concurrent_context_handlers, &std_object_handlers, sizeof(zend_object_handlers));
 	concurrent_context_handlers.free_obj = concurrent_context_object_destroy;
 	concurrent_context_handlers.clone_obj = NULL;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\ContextKey", context_key_functions);
+	concurrent_context_key_ce = zend_register_internal_class(&ce);
+	concurrent_context_key_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_context_key_ce->create_object = concurrent_context_key_object_create;
+	concurrent_context_key_ce->serialize = zend_class_serialize_deny;
+	concurrent_context_key_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_context_key_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_context_key_handlers.free_obj = concurrent_context_key_object_destroy;
+	concurrent_context_key_handlers.clone_obj = NULL;
 }
 
 void concurrent_context_shutdown()
@@ -503,8 +1055,11 @@ void concurrent_context_shutdown()
 
 	context = TASK_G(context);
 
+	// The object store frees the context after RSHUTDOWN, destroying it here would free its lookup cache twice.
 	if (context != NULL) {
-		concurrent_context_object_destroy(&context->std);
+		TASK_G(context) = NULL;
+
+		OBJ_RELEASE(&context->std);
 	}
 }
 
@@ -39,15 +39,36 @@ static concurrent_deferred_awaitable *concurrent_deferred_awaitable_object_creat
 {
 	concurrent_deferred_awaitable *awaitable;
 
-	awaitable = emalloc(sizeof(concurrent_deferred));
-	ZEND_SECURE_ZERO(awaitable, sizeof(concurrent_deferred));
+	awaitable = emalloc(sizeof(concurrent_deferred_awaitable));
+	ZEND_SECURE_ZERO(awaitable, sizeof(concurrent_deferred_awaitable));
 
 	zend_object_std_init(&awaitable->std, concurrent_deferred_awaitable_ce);
 	awaitable->std.handlers = &concurrent_deferred_awaitable_handlers;
 
 	awaitable->defer = defer;
 
-	GC_ADDREF(&defer->std);
+	ZVAL_UNDEF(&awaitable->result);
+
+	if (defer != NULL) {
+		GC_ADDREF(&defer->std);
+	}
+
+	return awaitable;
+}
+
+/* Creates an awaitable that carries its outcome and is not backed by a deferred. */
+static concurrent_deferred_awaitable *concurrent_deferred_awaitable_object_create_resolved(zval *result, zend_uchar status)
+{
+	concurrent_deferred_awaitable *awaitable;
+
+	awaitable = concurrent_deferred_awaitable_object_create(NULL);
+	awaitable->status = status;
+
+	if (result == NULL) {
+		ZVAL_NULL(&awaitable->result);
+	} else {
+		ZVAL_COPY(&awaitable->result, result);
+	}
 
 	return awaitable;
 }
@@ -58,7 +79,13 @@ static void concurrent_deferred_awaitable_object_destroy(zend_object *object)
 
 	awaitable = (concurrent_deferred_awaitable *) object;
 
-	OBJ_RELEASE(&awaitable->defer->std);
+	if (awaitable->defer != NULL) {
+		awaitable->defer->awaitable = NULL;
+
+		OBJ_RELEASE(&awaitable->defer->std);
+	}
+
+	zval_ptr_dtor(&awaitable->result);
 
 	zend_object_std_dtor(&awaitable->std);
 }
@@ -73,8 +100,15 @@ ZEND_METHOD(DeferredAwaitable, __construct)
 ZEND_BEGIN_ARG_INFO_EX(arginfo_deferred_awaitable_ctor, 0, 0, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_deferred_awaitable_transform, 0, 1, Concurrent\\Awaitable, 0)
+	ZEND_ARG_CALLABLE_INFO(0, callback, 0)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry deferred_awaitable_functions[] = {
 	ZEND_ME(DeferredAwaitable, __construct, arginfo_deferred_awaitable_ctor, ZEND_ACC_PRIVATE | ZEND_ACC_CTOR)
+	ZEND_ME(Awaitable, map, arginfo_deferred_awaitable_transform, ZEND_ACC_PUBLIC)
+	ZEND_ME(Awaitable, catch, arginfo_deferred_awaitable_transform, ZEND_ACC_PUBLIC)
+	ZEND_ME(Awaitable, finally, arginfo_deferred_awaitable_transform, ZEND_ACC_PUBLIC)
 	ZEND_FE_END
 };
 
@@ -104,13 +138,59 @@ static void concurrent_deferred_object_destroy(zend_object *object)
 
 	zval_ptr_dtor(&defer->result);
 
-	if (defer->continuation != NULL) {
+	if (defer->continuation.first != NULL) {
 		concurrent_awaitable_dispose_continuation(&defer->continuation);
 	}
 
 	zend_object_std_dtor(&defer->std);
 }
 
+concurrent_deferred *concurrent_deferred_create()
+{
+	return (concurrent_deferred *) concurrent_deferred_object_create(concurrent_deferred_ce);
+}
+
+/* Populates obj with the awaitable of the deferred, the caller owns the added reference. */
+void concurrent_deferred_get_awaitable(concurrent_deferred *defer, zval *obj)
+{
+	if (defer->awaitable == NULL) {
+		defer->awaitable = concurrent_deferred_awaitable_object_create(defer);
+
+		ZVAL_OBJ(obj, &defer->awaitable->std);
+	} else {
+		ZVAL_OBJ(obj, &defer->awaitable->std);
+		Z_ADDREF_P(obj);
+	}
+}
+
+void concurrent_deferred_resolve(concurrent_deferred *defer, zval *val)
+{
+	if (defer->status != CONCURRENT_DEFERRED_STATUS_PENDING) {
+		return;
+	}
+
+	if (val != NULL) {
+		ZVAL_COPY(&defer->result, val);
+	}
+
+	defer->status = CONCURRENT_DEFERRED_STATUS_RESOLVED;
+
+	concurrent_awaitable_trigger_continuation(&defer->continuation, &defer->result, 1);
+}
+
+void concurrent_deferred_fail(concurrent_deferred *defer, zval *error)
+{
+	if (defer->status != CONCURRENT_DEFERRED_STATUS_PENDING) {
+		return;
+	}
+
+	ZVAL_COPY(&defer->result, error);
+
+	defer->status = CONCURRENT_DEFERRED_STATUS_FAILED;
+
+	concurrent_awaitable_trigger_continuation(&defer->continuation, &defer->result, 0);
+}
+
 ZEND_METHOD(Deferred, awaitable)
 {
 	concurrent_deferred *defer;
@@ -121,15 +201,13 @@ ZEND_METHOD(Deferred, awaitable)
 
 	defer = (concurrent_deferred *) Z_OBJ_P(getThis());
 
-	ZVAL_OBJ(&obj, &concurrent_deferred_awaitable_object_create(defer)->std);
+	concurrent_deferred_get_awaitable(defer, &obj);
 
 	RETURN_ZVAL(&obj, 1, 1);
 }
 
 ZEND_METHOD(Deferred, resolve)
 {
-	concurrent_deferred *defer;
-
 	zval *val;
 
 	val = NULL;
@@ -139,51 +217,27 @@ ZEND_METHOD(Deferred, resolve)
 		Z_PARAM_ZVAL(val)
 	ZEND_PARSE_PARAMETERS_END();
 
-	defer = (concurrent_deferred *) Z_OBJ_P(getThis());
-
-	if (defer->status != CONCURRENT_DEFERRED_STATUS_PENDING) {
-		return;
-	}
-
-	if (val != NULL) {
-		ZVAL_COPY(&defer->result, val);
-	}
-
-	defer->status = CONCURRENT_DEFERRED_STATUS_RESOLVED;
-
-	concurrent_awaitable_trigger_continuation(&defer->continuation, &defer->result, 1);
+	concurrent_deferred_resolve((concurrent_deferred *) Z_OBJ_P(getThis()), val);
 }
 
 ZEND_METHOD(Deferred, fail)
 {
-	concurrent_deferred *defer;
-
 	zval *error;
 
 	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
 		Z_PARAM_ZVAL(error)
 	ZEND_PARSE_PARAMETERS_END();
 
-	defer = (concurrent_deferred *) Z_OBJ_P(getThis());
-
-	if (defer->status != CONCURRENT_DEFERRED_STATUS_PENDING) {
-		return;
-	}
-
-	ZVAL_COPY(&defer->result, error);
-
-	defer->status = CONCURRENT_DEFERRED_STATUS_FAILED;
-
-	concurrent_awaitable_trigger_continuation(&defer->continuation, &defer->result, 0);
+	concurrent_deferred_fail((concurrent_deferred *) Z_OBJ_P(getThis()), error);
 }
 
 ZEND_METHOD(Deferred, value)
 {
-	concurrent_deferred *defer;
 	concurrent_deferred_awaitable *awaitable;
 
 	zval *val;
 	zval obj;
+	zend_uchar type;
 
 	val = NULL;
 
@@ -192,32 +246,32 @@ ZEND_METHOD(Deferred, value)
 		Z_PARAM_ZVAL(val)
 	ZEND_PARSE_PARAMETERS_END();
 
-	defer = emalloc(sizeof(concurrent_deferred));
-	ZEND_SECURE_ZERO(defer, sizeof(concurrent_deferred));
+	type = (val == NULL) ? IS_NULL : Z_TYPE_P(val);
 
-	defer->status = CONCURRENT_DEFERRED_STATUS_RESOLVED;
+	// Awaitables resolved with null or a boolean are immutable and shared.
+	if (type == IS_NULL || type == IS_FALSE || type == IS_TRUE) {
+		awaitable = TASK_G(deferred_values)[type - IS_NULL];
 
-	if (val == NULL) {
-		ZVAL_NULL(&defer->result);
-	} else {
-		ZVAL_COPY(&defer->result, val);
-	}
+		if (awaitable == NULL) {
+			awaitable = concurrent_deferred_awaitable_object_create_resolved(val, CONCURRENT_DEFERRED_STATUS_RESOLVED);
 
-	zend_object_std_init(&defer->std, concurrent_deferred_ce);
-	defer->std.handlers = &concurrent_deferred_handlers;
+			TASK_G(deferred_values)[type - IS_NULL] = awaitable;
+		}
 
-	awaitable = concurrent_deferred_awaitable_object_create(defer);
+		ZVAL_OBJ(&obj, &awaitable->std);
 
-	ZVAL_OBJ(&obj, &awaitable->std);
+		RETURN_ZVAL(&obj, 1, 0);
+	}
+
+	awaitable = concurrent_deferred_awaitable_object_create_resolved(val, CONCURRENT_DEFERRED_STATUS_RESOLVED);
 
-	OBJ_RELEASE(&defer->std);
+	ZVAL_OBJ(&obj, &awaitable->std);
 
 	RETURN_ZVAL(&obj, 1, 1);
 }
 
 ZEND_METHOD(Deferred, error)
 {
-	concurrent_deferred *defer;
 	concurrent_deferred_awaitable *awaitable;
 
 	zval *error;
@@ -227,22 +281,10 @@ ZEND_METHOD(Deferred, error)
 		Z_PARAM_ZVAL(error)
 	ZEND_PARSE_PARAMETERS_END();
 
-	defer = emalloc(sizeof(concurrent_deferred));
-	ZEND_SECURE_ZERO(defer, sizeof(concurrent_deferred));
-
-	defer->status = CONCURRENT_DEFERRED_STATUS_FAILED;
-
-	ZVAL_COPY(&defer->result, error);
-
-	zend_object_std_init(&defer->std, concurrent_deferred_ce);
-	defer->std.handlers = &concurrent_deferred_handlers;
-
-	awaitable = concurrent_deferred_awaitable_object_create(defer);
+	awaitable = concurrent_deferred_awaitable_object_create_resolved(error, CONCURRENT_DEFERRED_STATUS_FAILED);
 
 	ZVAL_OBJ(&obj, &awaitable->std);
 
-	OBJ_RELEASE(&defer->std);
-
 	RETURN_ZVAL(&obj, 1, 1);
 }
 
@@ -303,6 +345,22 @@ void concurrent_deferred_ce_register()
 	zend_class_implements(concurrent_deferred_awaitable_ce, 1, concurrent_awaitable_ce);
 }
 
+void concurrent_deferred_shutdown()
+{
+	concurrent_deferred_awaitable *awaitable;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		awaitable = TASK_G(deferred_values)[i];
+
+		if (awaitable != NULL) {
+			TASK_G(deferred_values)[i] = NULL;
+
+			OBJ_RELEASE(&awaitable->std);
+		}
+	}
+}
+
 
 /*
  * vim: sw=4 ts=4
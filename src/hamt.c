@@ -0,0 +1,645 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+
+#include "php_task.h"
+
+#define CONCURRENT_HAMT_BITS 5
+#define CONCURRENT_HAMT_MASK 31
+#define CONCURRENT_HAMT_HASH_BITS (sizeof(zend_ulong) * 8)
+
+/* Nodes below the last level that can be addressed by hash bits contain colliding entries in insertion order. */
+#define CONCURRENT_HAMT_IS_COLLISION(shift) ((shift) >= CONCURRENT_HAMT_HASH_BITS)
+
+#define CONCURRENT_HAMT_BIT(hash, shift) (((uint32_t) 1) << (((hash) >> (shift)) & CONCURRENT_HAMT_MASK))
+
+
+static zend_always_inline uint32_t concurrent_hamt_popcount(uint32_t x)
+{
+#if defined(__GNUC__)
+	return (uint32_t) __builtin_popcount(x);
+#else
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	x = (x + (x >> 4)) & 0x0F0F0F0F;
+
+	return (x * 0x01010101) >> 24;
+#endif
+}
+
+static zend_always_inline uint32_t concurrent_hamt_entry_count(concurrent_hamt_node *node, uint32_t shift)
+{
+	return CONCURRENT_HAMT_IS_COLLISION(shift) ? node->datamap : concurrent_hamt_popcount(node->datamap);
+}
+
+static zend_always_inline concurrent_hamt_node **concurrent_hamt_children(concurrent_hamt_node *node, uint32_t entries)
+{
+	return (concurrent_hamt_node **) (node->entries + entries);
+}
+
+static zend_always_inline void concurrent_hamt_entry_init(concurrent_hamt_entry *entry, zend_string *key, zval *value)
+{
+	entry->key = zend_string_copy(key);
+	ZVAL_COPY(&entry->value, value);
+}
+
+static zend_always_inline void concurrent_hamt_entry_copy(concurrent_hamt_entry *entry, concurrent_hamt_entry *src)
+{
+	entry->key = zend_string_copy(src->key);
+	ZVAL_COPY(&entry->value, &src->value);
+}
+
+static zend_always_inline void concurrent_hamt_entry_replace(concurrent_hamt_entry *entry, zval *value)
+{
+	zval tmp;
+
+	ZVAL_COPY_VALUE(&tmp, &entry->value);
+	ZVAL_COPY(&entry->value, value);
+
+	zval_ptr_dtor(&tmp);
+}
+
+static zend_always_inline zend_bool concurrent_hamt_entry_matches(concurrent_hamt_entry *entry, zend_ulong hash, zend_string *key)
+{
+	return entry->key == key || (ZSTR_H(entry->key) == hash && zend_string_equals(entry->key, key));
+}
+
+static concurrent_hamt_node *concurrent_hamt_node_alloc(uint32_t entries, uint32_t children, uint32_t datamap, uint32_t nodemap)
+{
+	concurrent_hamt_node *node;
+
+	node = emalloc(XtOffsetOf(concurrent_hamt_node, entries) + entries * sizeof(concurrent_hamt_entry) + children * sizeof(concurrent_hamt_node *));
+
+	node->refcount = 1;
+	node->datamap = datamap;
+	node->nodemap = nodemap;
+
+	return node;
+}
+
+static void concurrent_hamt_node_release(concurrent_hamt_node *node, uint32_t shift)
+{
+	concurrent_hamt_node **children;
+	uint32_t count;
+	uint32_t i;
+
+	if (--node->refcount > 0) {
+		return;
+	}
+
+	count = concurrent_hamt_entry_count(node, shift);
+	children = concurrent_hamt_children(node, count);
+
+	for (i = 0; i < count; i++) {
+		zend_string_release(node->entries[i].key);
+		zval_ptr_dtor(&node->entries[i].value);
+	}
+
+	count = concurrent_hamt_popcount(node->nodemap);
+
+	for (i = 0; i < count; i++) {
+		concurrent_hamt_node_release(children[i], shift + CONCURRENT_HAMT_BITS);
+	}
+
+	efree(node);
+}
+
+/* Copies a range of entries, keys and values are shared with the source entries. */
+static void concurrent_hamt_copy_entries(concurrent_hamt_entry *entries, concurrent_hamt_entry *src, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		concurrent_hamt_entry_copy(&entries[i], &src[i]);
+	}
+}
+
+/* Copies a range of child node pointers, the child nodes are shared with the source node. */
+static void concurrent_hamt_copy_children(concurrent_hamt_node **children, concurrent_hamt_node **src, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		children[i] = src[i];
+		children[i]->refcount++;
+	}
+}
+
+/* Creates a node that contains an existing entry and a new entry with a different key. */
+static concurrent_hamt_node *concurrent_hamt_node_merge(concurrent_hamt_entry *entry, zend_string *key, zval *value, zend_ulong hash, uint32_t shift)
+{
+	concurrent_hamt_node *node;
+	uint32_t a;
+	uint32_t b;
+
+	if (CONCURRENT_HAMT_IS_COLLISION(shift)) {
+		node = concurrent_hamt_node_alloc(2, 0, 2, 0);
+
+		concurrent_hamt_entry_copy(&node->entries[0], entry);
+		concurrent_hamt_entry_init(&node->entries[1], key, value);
+
+		return node;
+	}
+
+	a = CONCURRENT_HAMT_BIT(ZSTR_H(entry->key), shift);
+	b = CONCURRENT_HAMT_BIT(hash, shift);
+
+	if (a == b) {
+		node = concurrent_hamt_node_alloc(0, 1, 0, a);
+
+		concurrent_hamt_children(node, 0)[0] = concurrent_hamt_node_merge(entry, key, value, hash, shift + CONCURRENT_HAMT_BITS);
+
+		return node;
+	}
+
+	node = concurrent_hamt_node_alloc(2, 0, a | b, 0);
+
+	if (a < b) {
+		concurrent_hamt_entry_copy(&node->entries[0], entry);
+		concurrent_hamt_entry_init(&node->entries[1], key, value);
+	} else {
+		concurrent_hamt_entry_init(&node->entries[0], key, value);
+		concurrent_hamt_entry_copy(&node->entries[1], entry);
+	}
+
+	return node;
+}
+
+static concurrent_hamt_node *concurrent_hamt_node_set(concurrent_hamt_node *node, uint32_t shift, zend_ulong hash, zend_string *key, zval *value, zend_bool *added)
+{
+	concurrent_hamt_node *copy;
+	concurrent_hamt_node **children;
+	concurrent_hamt_node **target;
+	uint32_t bit;
+	uint32_t n;
+	uint32_t m;
+	uint32_t i;
+	uint32_t j;
+
+	if (CONCURRENT_HAMT_IS_COLLISION(shift)) {
+		n = node->datamap;
+
+		for (i = 0; i < n; i++) {
+			if (concurrent_hamt_entry_matches(&node->entries[i], hash, key)) {
+				break;
+			}
+		}
+
+		if (i == n) {
+			*added = 1;
+
+			copy = concurrent_hamt_node_alloc(n + 1, 0, n + 1, 0);
+
+			concurrent_hamt_copy_entries(copy->entries, node->entries, n);
+			concurrent_hamt_entry_init(&copy->entries[n], key, value);
+
+			return copy;
+		}
+
+		copy = concurrent_hamt_node_alloc(n, 0, n, 0);
+
+		concurrent_hamt_copy_entries(copy->entries, node->entries, i);
+		concurrent_hamt_entry_init(&copy->entries[i], key, value);
+		concurrent_hamt_copy_entries(copy->entries + i + 1, node->entries + i + 1, n - i - 1);
+
+		return copy;
+	}
+
+	bit = CONCURRENT_HAMT_BIT(hash, shift);
+	n = concurrent_hamt_popcount(node->datamap);
+	m = concurrent_hamt_popcount(node->nodemap);
+	children = concurrent_hamt_children(node, n);
+
+	i = concurrent_hamt_popcount(node->datamap & (bit - 1));
+	j = concurrent_hamt_popcount(node->nodemap & (bit - 1));
+
+	if (node->datamap & bit) {
+		if (concurrent_hamt_entry_matches(&node->entries[i], hash, key)) {
+			copy = concurrent_hamt_node_alloc(n, m, node->datamap, node->nodemap);
+
+			concurrent_hamt_copy_entries(copy->entries, node->entries, i);
+			concurrent_hamt_entry_init(&copy->entries[i], key, value);
+			concurrent_hamt_copy_entries(copy->entries + i + 1, node->entries + i + 1, n - i - 1);
+			concurrent_hamt_copy_children(concurrent_hamt_children(copy, n), children, m);
+
+			return copy;
+		}
+
+		// Push the existing entry down into a new child node together with the new entry.
+		*added = 1;
+
+		copy = concurrent_hamt_node_alloc(n - 1, m + 1, node->datamap & ~bit, node->nodemap | bit);
+		target = concurrent_hamt_children(copy, n - 1);
+
+		concurrent_hamt_copy_entries(copy->entries, node->entries, i);
+		concurrent_hamt_copy_entries(copy->entries + i, node->entries + i + 1, n - i - 1);
+
+		concurrent_hamt_copy_children(target, children, j);
+		target[j] = concurrent_hamt_node_merge(&node->entries[i], key, value, hash, shift + CONCURRENT_HAMT_BITS);
+		concurrent_hamt_copy_children(target + j + 1, children + j, m - j);
+
+		return copy;
+	}
+
+	if (node->nodemap & bit) {
+		copy = concurrent_hamt_node_alloc(n, m, node->datamap, node->nodemap);
+		target = concurrent_hamt_children(copy, n);
+
+		concurrent_hamt_copy_entries(copy->entries, node->entries, n);
+
+		concurrent_hamt_copy_children(target, children, j);
+		target[j] = concurrent_hamt_node_set(children[j], shift + CONCURRENT_HAMT_BITS, hash, key, value, added);
+		concurrent_hamt_copy_children(target + j + 1, children + j + 1, m - j - 1);
+
+		return copy;
+	}
+
+	*added = 1;
+
+	copy = concurrent_hamt_node_alloc(n + 1, m, node->datamap | bit, node->nodemap);
+
+	concurrent_hamt_copy_entries(copy->entries, node->entries, i);
+	concurrent_hamt_entry_init(&copy->entries[i], key, value);
+	concurrent_hamt_copy_entries(copy->entries + i + 1, node->entries + i, n - i);
+	concurrent_hamt_copy_children(concurrent_hamt_children(copy, n + 1), children, m);
+
+	return copy;
+}
+
+/* Sets an entry in a node that is owned exclusively by the map being built in place, shared nodes are copied. */
+static concurrent_hamt_node *concurrent_hamt_node_assign(concurrent_hamt_node *node, uint32_t shift, zend_ulong hash, zend_string *key, zval *value, zend_bool *added)
+{
+	concurrent_hamt_node *copy;
+	concurrent_hamt_node **children;
+	uint32_t bit;
+	uint32_t n;
+	uint32_t m;
+	uint32_t i;
+	uint32_t j;
+
+	if (node->refcount > 1) {
+		copy = concurrent_hamt_node_set(node, shift, hash, key, value, added);
+		node->refcount--;
+
+		return copy;
+	}
+
+	if (CONCURRENT_HAMT_IS_COLLISION(shift)) {
+		n = node->datamap;
+
+		for (i = 0; i < n; i++) {
+			if (concurrent_hamt_entry_matches(&node->entries[i], hash, key)) {
+				concurrent_hamt_entry_replace(&node->entries[i], value);
+
+				return node;
+			}
+		}
+
+		*added = 1;
+
+		node = erealloc(node, XtOffsetOf(concurrent_hamt_node, entries) + (n + 1) * sizeof(concurrent_hamt_entry));
+		node->datamap = n + 1;
+
+		concurrent_hamt_entry_init(&node->entries[n], key, value);
+
+		return node;
+	}
+
+	bit = CONCURRENT_HAMT_BIT(hash, shift);
+	n = concurrent_hamt_popcount(node->datamap);
+	m = concurrent_hamt_popcount(node->nodemap);
+	children = concurrent_hamt_children(node, n);
+
+	i = concurrent_hamt_popcount(node->datamap & (bit - 1));
+	j = concurrent_hamt_popcount(node->nodemap & (bit - 1));
+
+	if (node->datamap & bit) {
+		if (concurrent_hamt_entry_matches(&node->entries[i], hash, key)) {
+			concurrent_hamt_entry_replace(&node->entries[i], value);
+
+			return node;
+		}
+
+		copy = concurrent_hamt_node_set(node, shift, hash, key, value, added);
+		concurrent_hamt_node_release(node, shift);
+
+		return copy;
+	}
+
+	if (node->nodemap & bit) {
+		children[j] = concurrent_hamt_node_assign(children[j], shift + CONCURRENT_HAMT_BITS, hash, key, value, added);
+
+		return node;
+	}
+
+	*added = 1;
+
+	// Grow the node and shift child pointers and the following entries to make room for the new entry.
+	node = erealloc(node, XtOffsetOf(concurrent_hamt_node, entries) + (n + 1) * sizeof(concurrent_hamt_entry) + m * sizeof(concurrent_hamt_node *));
+
+	memmove(concurrent_hamt_children(node, n + 1), concurrent_hamt_children(node, n), m * sizeof(concurrent_hamt_node *));
+	memmove(node->entries + i + 1, node->entries + i, (n - i) * sizeof(concurrent_hamt_entry));
+
+	node->datamap |= bit;
+
+	concurrent_hamt_entry_init(&node->entries[i], key, value);
+
+	return node;
+}
+
+/* Removes an entry that is known to exist, returns NULL if the node does not contain anything else. */
+static concurrent_hamt_node *concurrent_hamt_node_remove(concurrent_hamt_node *node, uint32_t shift, zend_ulong hash, zend_string *key)
+{
+	concurrent_hamt_node *copy;
+	concurrent_hamt_node *sub;
+	concurrent_hamt_node **children;
+	concurrent_hamt_node **target;
+	uint32_t bit;
+	uint32_t n;
+	uint32_t m;
+	uint32_t i;
+	uint32_t j;
+
+	if (CONCURRENT_HAMT_IS_COLLISION(shift)) {
+		n = node->datamap;
+
+		if (n == 1) {
+			return NULL;
+		}
+
+		for (i = 0; !concurrent_hamt_entry_matches(&node->entries[i], hash, key); i++);
+
+		copy = concurrent_hamt_node_alloc(n - 1, 0, n - 1, 0);
+
+		concurrent_hamt_copy_entries(copy->entries, node->entries, i);
+		concurrent_hamt_copy_entries(copy->entries + i, node->entries + i + 1, n - i - 1);
+
+		return copy;
+	}
+
+	bit = CONCURRENT_HAMT_BIT(hash, shift);
+	n = concurrent_hamt_popcount(node->datamap);
+	m = concurrent_hamt_popcount(node->nodemap);
+	children = concurrent_hamt_children(node, n);
+
+	i = concurrent_hamt_popcount(node->datamap & (bit - 1));
+	j = concurrent_hamt_popcount(node->nodemap & (bit - 1));
+
+	if (node->datamap & bit) {
+		if (n == 1 && m == 0) {
+			return NULL;
+		}
+
+		copy = concurrent_hamt_node_alloc(n - 1, m, node->datamap & ~bit, node->nodemap);
+
+		concurrent_hamt_copy_entries(copy->entries, node->entries, i);
+		concurrent_hamt_copy_entries(copy->entries + i, node->entries + i + 1, n - i - 1);
+		concurrent_hamt_copy_children(concurrent_hamt_children(copy, n - 1), children, m);
+
+		return copy;
+	}
+
+	ZEND_ASSERT(node->nodemap & bit);
+
+	sub = concurrent_hamt_node_remove(children[j], shift + CONCURRENT_HAMT_BITS, hash, key);
+
+	if (sub == NULL) {
+		if (n == 0 && m == 1) {
+			return NULL;
+		}
+
+		copy = concurrent_hamt_node_alloc(n, m - 1, node->datamap, node->nodemap & ~bit);
+		target = concurrent_hamt_children(copy, n);
+
+		concurrent_hamt_copy_entries(copy->entries, node->entries, n);
+		concurrent_hamt_copy_children(target, children, j);
+		concurrent_hamt_copy_children(target + j, children + j + 1, m - j - 1);
+
+		return copy;
+	}
+
+	// A child that is left with a single entry is replaced by the entry.
+	if (sub->nodemap == 0 && concurrent_hamt_entry_count(sub, shift + CONCURRENT_HAMT_BITS) == 1) {
+		copy = concurrent_hamt_node_alloc(n + 1, m - 1, node->datamap | bit, node->nodemap & ~bit);
+		target = concurrent_hamt_children(copy, n + 1);
+
+		concurrent_hamt_copy_entries(copy->entries, node->entries, i);
+		concurrent_hamt_entry_copy(&copy->entries[i], &sub->entries[0]);
+		concurrent_hamt_copy_entries(copy->entries + i + 1, node->entries + i, n - i);
+
+		concurrent_hamt_copy_children(target, children, j);
+		concurrent_hamt_copy_children(target + j, children + j + 1, m - j - 1);
+
+		concurrent_hamt_node_release(sub, shift + CONCURRENT_HAMT_BITS);
+
+		return copy;
+	}
+
+	copy = concurrent_hamt_node_alloc(n, m, node->datamap, node->nodemap);
+	target = concurrent_hamt_children(copy, n);
+
+	concurrent_hamt_copy_entries(copy->entries, node->entries, n);
+
+	concurrent_hamt_copy_children(target, children, j);
+	target[j] = sub;
+	concurrent_hamt_copy_children(target + j + 1, children + j + 1, m - j - 1);
+
+	return copy;
+}
+
+zval *concurrent_hamt_find(concurrent_hamt *map, zend_string *key)
+{
+	concurrent_hamt_node *node;
+	zend_ulong hash;
+	uint32_t shift;
+	uint32_t bit;
+	uint32_t i;
+
+	node = map->root;
+	hash = ZSTR_HASH(key);
+	shift = 0;
+
+	while (node != NULL) {
+		if (CONCURRENT_HAMT_IS_COLLISION(shift)) {
+			for (i = 0; i < node->datamap; i++) {
+				if (concurrent_hamt_entry_matches(&node->entries[i], hash, key)) {
+					return &node->entries[i].value;
+				}
+			}
+
+			return NULL;
+		}
+
+		bit = CONCURRENT_HAMT_BIT(hash, shift);
+
+		if (node->datamap & bit) {
+			i = concurrent_hamt_popcount(node->datamap & (bit - 1));
+
+			if (concurrent_hamt_entry_matches(&node->entries[i], hash, key)) {
+				return &node->entries[i].value;
+			}
+
+			return NULL;
+		}
+
+		if (!(node->nodemap & bit)) {
+			return NULL;
+		}
+
+		i = concurrent_hamt_popcount(node->nodemap & (bit - 1));
+
+		node = concurrent_hamt_children(node, concurrent_hamt_popcount(node->datamap))[i];
+		shift += CONCURRENT_HAMT_BITS;
+	}
+
+	return NULL;
+}
+
+/* Initializes map as a new version of src that shares all nodes with src. */
+void concurrent_hamt_copy(concurrent_hamt *map, concurrent_hamt *src)
+{
+	map->root = src->root;
+	map->count = src->count;
+
+	if (map->root != NULL) {
+		map->root->refcount++;
+	}
+}
+
+/* Initializes map as a new version of src that maps key to the given value. */
+void concurrent_hamt_set(concurrent_hamt *map, concurrent_hamt *src, zend_string *key, zval *value)
+{
+	zend_ulong hash;
+	zend_bool added;
+
+	ZEND_ASSERT(map != src);
+
+	hash = ZSTR_HASH(key);
+
+	if (src->root == NULL) {
+		map->root = concurrent_hamt_node_alloc(1, 0, CONCURRENT_HAMT_BIT(hash, 0), 0);
+		map->count = 1;
+
+		concurrent_hamt_entry_init(&map->root->entries[0], key, value);
+
+		return;
+	}
+
+	added = 0;
+
+	map->root = concurrent_hamt_node_set(src->root, 0, hash, key, value, &added);
+	map->count = src->count + added;
+}
+
+/*
+ * Sets key to the given value by modifying map in place. Nodes that are shared with other maps are copied, nodes that
+ * have been created by previous assignments are updated without allocating a new version.
+ */
+void concurrent_hamt_assign(concurrent_hamt *map, zend_string *key, zval *value)
+{
+	zend_ulong hash;
+	zend_bool added;
+
+	if (map->root == NULL) {
+		hash = ZSTR_HASH(key);
+
+		map->root = concurrent_hamt_node_alloc(1, 0, CONCURRENT_HAMT_BIT(hash, 0), 0);
+		map->count = 1;
+
+		concurrent_hamt_entry_init(&map->root->entries[0], key, value);
+
+		return;
+	}
+
+	added = 0;
+
+	map->root = concurrent_hamt_node_assign(map->root, 0, ZSTR_HASH(key), key, value, &added);
+	map->count += added;
+}
+
+/* Initializes map as a new version of src that does not contain the given key. */
+void concurrent_hamt_remove(concurrent_hamt *map, concurrent_hamt *src, zend_string *key)
+{
+	ZEND_ASSERT(map != src);
+
+	if (concurrent_hamt_find(src, key) == NULL) {
+		concurrent_hamt_copy(map, src);
+		return;
+	}
+
+	map->root = concurrent_hamt_node_remove(src->root, 0, ZSTR_H(key), key);
+	map->count = src->count - 1;
+}
+
+static void concurrent_hamt_node_merge_into(concurrent_hamt *map, concurrent_hamt_node *node, uint32_t shift)
+{
+	concurrent_hamt_node **children;
+	uint32_t count;
+	uint32_t i;
+
+	count = concurrent_hamt_entry_count(node, shift);
+	children = concurrent_hamt_children(node, count);
+
+	for (i = 0; i < count; i++) {
+		if (concurrent_hamt_find(map, node->entries[i].key) == NULL) {
+			concurrent_hamt_assign(map, node->entries[i].key, &node->entries[i].value);
+		}
+	}
+
+	count = concurrent_hamt_popcount(node->nodemap);
+
+	for (i = 0; i < count; i++) {
+		concurrent_hamt_node_merge_into(map, children[i], shift + CONCURRENT_HAMT_BITS);
+	}
+}
+
+/* Initializes map as a new version of src that also contains all entries of defaults with keys that are not in src. */
+void concurrent_hamt_merge(concurrent_hamt *map, concurrent_hamt *src, concurrent_hamt *defaults)
+{
+	ZEND_ASSERT(map != src && map != defaults);
+
+	if (src->count == 0) {
+		concurrent_hamt_copy(map, defaults);
+		return;
+	}
+
+	concurrent_hamt_copy(map, src);
+
+	if (defaults->root != NULL) {
+		concurrent_hamt_node_merge_into(map, defaults->root, 0);
+	}
+}
+
+void concurrent_hamt_destroy(concurrent_hamt *map)
+{
+	if (map->root != NULL) {
+		concurrent_hamt_node_release(map->root, 0);
+	}
+
+	map->root = NULL;
+	map->count = 0;
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,293 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+
+#include "php_task.h"
+
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#include <errno.h>
+#endif
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+#ifdef HAVE_POLL_H
+const int CONCURRENT_IO_WATCHER_READABLE = POLLIN;
+const int CONCURRENT_IO_WATCHER_WRITABLE = POLLOUT;
+#else
+const int CONCURRENT_IO_WATCHER_READABLE = 1;
+const int CONCURRENT_IO_WATCHER_WRITABLE = 4;
+#endif
+
+
+void concurrent_io_watcher_start(concurrent_io_watcher *watcher)
+{
+	concurrent_io_watcher *first;
+
+	if (watcher->active) {
+		return;
+	}
+
+	first = TASK_G(io_watchers);
+
+	watcher->prev = NULL;
+	watcher->next = first;
+	watcher->ready = NULL;
+	watcher->revents = 0;
+	watcher->active = 1;
+
+	if (first != NULL) {
+		first->prev = watcher;
+	}
+
+	TASK_G(io_watchers) = watcher;
+	TASK_G(io_watcher_count)++;
+}
+
+void concurrent_io_watcher_stop(concurrent_io_watcher *watcher)
+{
+	concurrent_io_watcher *current;
+
+	if (!watcher->active) {
+		return;
+	}
+
+	if (watcher->prev == NULL) {
+		TASK_G(io_watchers) = watcher->next;
+	} else {
+		watcher->prev->next = watcher->next;
+	}
+
+	if (watcher->next != NULL) {
+		watcher->next->prev = watcher->prev;
+	}
+
+	// Remove the watcher from the ready list if it has been stopped by another callback.
+	if (watcher->revents != 0) {
+		if (TASK_G(io_ready) == watcher) {
+			TASK_G(io_ready) = watcher->ready;
+		} else {
+			current = TASK_G(io_ready);
+
+			while (current != NULL && current->ready != watcher) {
+				current = current->ready;
+			}
+
+			if (current != NULL) {
+				current->ready = watcher->ready;
+			}
+		}
+	}
+
+	watcher->prev = NULL;
+	watcher->next = NULL;
+	watcher->ready = NULL;
+	watcher->revents = 0;
+	watcher->active = 0;
+
+	TASK_G(io_watcher_count)--;
+}
+
+#ifdef HAVE_POLL_H
+static void concurrent_io_watcher_continue(concurrent_io_watcher *watcher, int events)
+{
+	concurrent_task *task;
+
+	task = (concurrent_task *) watcher->object;
+
+	concurrent_io_watcher_stop(watcher);
+	concurrent_task_scheduler_enqueue(task);
+
+	OBJ_RELEASE(&task->fiber.std);
+}
+#endif
+
+/*
+ * Waits until the given descriptor is ready. The running task is suspended and continued by the scheduler,
+ * code that is not running in a task will block. Returns 0 if an error has been thrown.
+ */
+zend_bool concurrent_io_watcher_await(int fd, int events, zend_execute_data *execute_data)
+{
+#ifdef HAVE_POLL_H
+	concurrent_io_watcher watcher;
+	concurrent_fiber *fiber;
+	struct pollfd pfd;
+
+	fiber = TASK_G(current_fiber);
+
+	if (fiber == NULL || fiber->type != CONCURRENT_FIBER_TYPE_TASK) {
+		pfd.fd = fd;
+		pfd.events = (short) events;
+		pfd.revents = 0;
+
+		while (poll(&pfd, 1, -1) < 0) {
+			if (errno != EINTR) {
+				zend_throw_error(NULL, "Failed to poll file descriptor: %s", strerror(errno));
+				return 0;
+			}
+		}
+
+		return 1;
+	}
+
+	if (UNEXPECTED(fiber->status != CONCURRENT_FIBER_STATUS_RUNNING)) {
+		zend_throw_error(NULL, "Cannot await in a task that is not running");
+		return 0;
+	}
+
+	// The watcher lives on the C stack of the task which is preserved until the task is continued.
+	ZEND_SECURE_ZERO(&watcher, sizeof(concurrent_io_watcher));
+
+	watcher.fd = fd;
+	watcher.events = events;
+	watcher.func = concurrent_io_watcher_continue;
+	watcher.object = fiber;
+
+	concurrent_io_watcher_start(&watcher);
+	concurrent_task_suspend((concurrent_task *) fiber, NULL, execute_data);
+	concurrent_io_watcher_stop(&watcher);
+
+	return EG(exception) == NULL;
+#else
+	zend_throw_error(NULL, "Awaiting file descriptors requires poll() which is not available on this platform");
+
+	return 0;
+#endif
+}
+
+/*
+ * Waits for at least one active watcher to become ready (timeout is given in milliseconds, -1 blocks until
+ * any watcher becomes ready). Returns the number of invoked callbacks or -1 if there are no active watchers.
+ */
+int concurrent_io_watcher_poll(zend_long timeout)
+{
+#ifdef HAVE_POLL_H
+	concurrent_io_watcher *watcher;
+	concurrent_io_watcher **watchers;
+	struct pollfd *fds;
+	uint32_t count;
+	uint32_t i;
+	int events;
+	int num;
+
+	count = TASK_G(io_watcher_count);
+
+	if (count == 0) {
+		return -1;
+	}
+
+	if (count > TASK_G(io_poll_size)) {
+		TASK_G(io_poll_fds) = erealloc(TASK_G(io_poll_fds), sizeof(struct pollfd) * count);
+		TASK_G(io_poll_watchers) = erealloc(TASK_G(io_poll_watchers), sizeof(concurrent_io_watcher *) * count);
+		TASK_G(io_poll_size) = count;
+	}
+
+	fds = (struct pollfd *) TASK_G(io_poll_fds);
+	watchers = TASK_G(io_poll_watchers);
+
+	for (watcher = TASK_G(io_watchers), i = 0; watcher != NULL; watcher = watcher->next, i++) {
+		fds[i].fd = watcher->fd;
+		fds[i].events = (short) watcher->events;
+		fds[i].revents = 0;
+
+		watchers[i] = watcher;
+	}
+
+	num = poll(fds, count, (int) timeout);
+
+	if (num <= 0) {
+		if (num < 0 && errno != EINTR) {
+			php_error_docref(NULL, E_WARNING, "Failed to poll native I/O watchers: %s", strerror(errno));
+		}
+
+		return 0;
+	}
+
+	// Collect ready watchers first, callbacks are allowed to start and stop watchers.
+	for (i = 0; i < count; i++) {
+		if (fds[i].revents != 0) {
+			watchers[i]->revents = fds[i].revents;
+			watchers[i]->ready = TASK_G(io_ready);
+
+			TASK_G(io_ready) = watchers[i];
+		}
+	}
+
+	num = 0;
+
+	while (TASK_G(io_ready) != NULL) {
+		watcher = TASK_G(io_ready);
+		TASK_G(io_ready) = watcher->ready;
+
+		events = watcher->revents;
+
+		watcher->ready = NULL;
+		watcher->revents = 0;
+
+		watcher->func(watcher, events);
+
+		num++;
+	}
+
+	return num;
+#else
+	return -1;
+#endif
+}
+
+void concurrent_io_watcher_shutdown()
+{
+	concurrent_io_watcher *watcher;
+	concurrent_io_watcher *next;
+
+	// Watchers embedded in objects will be stopped when the object store is freed, detach them first.
+	for (watcher = TASK_G(io_watchers); watcher != NULL; watcher = next) {
+		next = watcher->next;
+
+		watcher->prev = NULL;
+		watcher->next = NULL;
+		watcher->ready = NULL;
+		watcher->revents = 0;
+		watcher->active = 0;
+	}
+
+	if (TASK_G(io_poll_fds) != NULL) {
+		efree(TASK_G(io_poll_fds));
+		efree(TASK_G(io_poll_watchers));
+	}
+
+	TASK_G(io_watchers) = NULL;
+	TASK_G(io_watcher_count) = 0;
+	TASK_G(io_ready) = NULL;
+	TASK_G(io_poll_fds) = NULL;
+	TASK_G(io_poll_watchers) = NULL;
+	TASK_G(io_poll_size) = 0;
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,411 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "php_network.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+#include <errno.h>
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+zend_class_entry *concurrent_server_ce;
+
+static zend_object_handlers concurrent_server_handlers;
+
+/* Max number of connections being accepted whenever the listening socket becomes readable. */
+#define CONCURRENT_SERVER_ACCEPT_BATCH 64
+
+
+static void concurrent_server_continuation(void *obj, zval *result, zend_bool success)
+{
+	concurrent_server *server;
+
+	server = (concurrent_server *) obj;
+
+	server->in_flight--;
+
+	if (!server->closed && (server->max_in_flight == 0 || server->in_flight < server->max_in_flight)) {
+		concurrent_io_watcher_start(&server->io);
+	}
+
+	OBJ_RELEASE(&server->std);
+}
+
+static void concurrent_server_spawn(concurrent_server *server, php_socket_t fd)
+{
+	concurrent_task *task;
+	php_stream *stream;
+
+	zval sock;
+
+	stream = php_stream_sock_open_from_socket(fd, NULL);
+
+	if (stream == NULL) {
+		closesocket(fd);
+		return;
+	}
+
+	php_stream_to_zval(stream, &sock);
+
+	task = concurrent_task_object_create();
+	task->scheduler = server->scheduler;
+	task->context = server->context;
+
+	task->fiber.fci = server->fci;
+	task->fiber.fcc = server->fcc;
+	task->fiber.fci.no_separation = 1;
+
+	zend_fcall_info_argn(&task->fiber.fci, 1, &sock);
+	zval_ptr_dtor(&sock);
+
+	Z_TRY_ADDREF_P(&task->fiber.fci.function_name);
+
+	GC_ADDREF(&task->context->std);
+
+	// Track completion of the task in order to enforce the limit of connections in flight.
+	concurrent_awaitable_append_continuation(&task->continuation, server, concurrent_server_continuation);
+
+	GC_ADDREF(&server->std);
+	server->in_flight++;
+
+	concurrent_task_scheduler_enqueue(task);
+
+	OBJ_RELEASE(&task->fiber.std);
+}
+
+static void concurrent_server_close(concurrent_server *server);
+
+/*
+ * Handles a failed accept() call. The listening socket stays readable if connections cannot be accepted due to
+ * resource limits, the watcher must be stopped to avoid spinning in the native wait.
+ */
+static void concurrent_server_accept_failed(concurrent_server *server, int error)
+{
+	char buf[256];
+
+	switch (error) {
+	case EAGAIN:
+#if defined(EWOULDBLOCK) && EWOULDBLOCK != EAGAIN
+	case EWOULDBLOCK:
+#endif
+	case EINTR:
+#ifdef ECONNABORTED
+	case ECONNABORTED:
+#endif
+		return;
+	case EMFILE:
+#ifdef ENFILE
+	case ENFILE:
+#endif
+#ifdef ENOBUFS
+	case ENOBUFS:
+#endif
+	case ENOMEM:
+		// Accepting is resumed when a connection task completes and releases its descriptor.
+		if (server->in_flight > 0) {
+			concurrent_io_watcher_stop(&server->io);
+
+			return;
+		}
+	}
+
+	php_error_docref(NULL, E_WARNING, "Failed to accept connection, closing server: %s", php_socket_strerror(error, buf, sizeof(buf)));
+
+	concurrent_server_close(server);
+}
+
+static void concurrent_server_accept(concurrent_io_watcher *io, int events)
+{
+	concurrent_server *server;
+	php_socket_t fd;
+	int i;
+
+	server = (concurrent_server *) io->object;
+
+	for (i = 0; i < CONCURRENT_SERVER_ACCEPT_BATCH; i++) {
+		if (server->max_in_flight > 0 && server->in_flight >= server->max_in_flight) {
+			concurrent_io_watcher_stop(io);
+			break;
+		}
+
+		fd = accept(io->fd, NULL, NULL);
+
+		if (fd == SOCK_ERR) {
+			concurrent_server_accept_failed(server, php_socket_errno());
+			break;
+		}
+
+		concurrent_server_spawn(server, fd);
+
+		if (server->closed) {
+			break;
+		}
+	}
+}
+
+static void concurrent_server_close(concurrent_server *server)
+{
+	if (server->closed) {
+		return;
+	}
+
+	server->closed = 1;
+
+	concurrent_io_watcher_stop(&server->io);
+
+	closesocket(server->io.fd);
+	server->io.fd = -1;
+}
+
+
+static zend_object *concurrent_server_object_create(zend_class_entry *ce)
+{
+	concurrent_server *server;
+
+	server = emalloc(sizeof(concurrent_server));
+	ZEND_SECURE_ZERO(server, sizeof(concurrent_server));
+
+	server->io.fd = -1;
+	server->io.events = CONCURRENT_IO_WATCHER_READABLE;
+	server->io.func = concurrent_server_accept;
+	server->io.object = server;
+
+	server->closed = 1;
+
+	zend_object_std_init(&server->std, ce);
+	server->std.handlers = &concurrent_server_handlers;
+
+	return &server->std;
+}
+
+static void concurrent_server_object_destroy(zend_object *object)
+{
+	concurrent_server *server;
+
+	server = (concurrent_server *) object;
+
+	concurrent_server_close(server);
+
+	if (server->context != NULL) {
+		zval_ptr_dtor(&server->fci.function_name);
+
+		OBJ_RELEASE(&server->context->std);
+	}
+
+	zend_object_std_dtor(&server->std);
+}
+
+ZEND_METHOD(Server, __construct)
+{
+	concurrent_server *server;
+	zend_string *host;
+	zend_string *error;
+	zend_long port;
+	zend_long backlog;
+	php_socket_t fd;
+	long sockopts;
+	int code;
+
+	server = (concurrent_server *) Z_OBJ_P(getThis());
+
+	if (server->context != NULL) {
+		zend_throw_error(NULL, "Server must not be constructed more than once");
+		return;
+	}
+
+	backlog = SOMAXCONN;
+	error = NULL;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 3, 5)
+		Z_PARAM_STR(host)
+		Z_PARAM_LONG(port)
+		Z_PARAM_FUNC_EX(server->fci, server->fcc, 1, 0)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(server->max_in_flight)
+		Z_PARAM_LONG(backlog)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (port < 0 || port > 65535) {
+		zend_throw_error(NULL, "Invalid server port %d", (int) port);
+		return;
+	}
+
+	if (server->max_in_flight < 0) {
+		server->max_in_flight = 0;
+	}
+
+	sockopts = 0;
+
+#ifdef STREAM_SOCKOP_SO_REUSEPORT
+	// Allow multiple worker processes to bind the same address, the kernel will balance connections.
+	sockopts |= STREAM_SOCKOP_SO_REUSEPORT;
+#endif
+
+	fd = php_network_bind_socket_to_local_addr(ZSTR_VAL(host), (unsigned) port, SOCK_STREAM, sockopts, &error, &code);
+
+	if (fd == SOCK_ERR) {
+		zend_throw_error(NULL, "Failed to bind server to %s:%d: %s", ZSTR_VAL(host), (int) port, (error == NULL) ? "unknown error" : ZSTR_VAL(error));
+
+		if (error != NULL) {
+			zend_string_release(error);
+		}
+
+		return;
+	}
+
+	if (listen(fd, (int) backlog) != 0) {
+		closesocket(fd);
+
+		zend_throw_error(NULL, "Failed to listen on %s:%d", ZSTR_VAL(host), (int) port);
+		return;
+	}
+
+	php_set_sock_blocking(fd, 0);
+
+	Z_TRY_ADDREF_P(&server->fci.function_name);
+
+	server->scheduler = concurrent_task_scheduler_get();
+	server->context = concurrent_context_get();
+
+	GC_ADDREF(&server->context->std);
+
+	server->io.fd = (int) fd;
+	server->closed = 0;
+
+	concurrent_io_watcher_start(&server->io);
+}
+
+ZEND_METHOD(Server, count)
+{
+	concurrent_server *server;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	server = (concurrent_server *) Z_OBJ_P(getThis());
+
+	RETURN_LONG(server->in_flight);
+}
+
+ZEND_METHOD(Server, getPort)
+{
+	concurrent_server *server;
+	php_sockaddr_storage addr;
+	socklen_t len;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	server = (concurrent_server *) Z_OBJ_P(getThis());
+
+	if (server->closed) {
+		zend_throw_error(NULL, "Cannot access the port of a closed server");
+		return;
+	}
+
+	len = sizeof(addr);
+
+	if (getsockname(server->io.fd, (struct sockaddr *) &addr, &len) != 0) {
+		zend_throw_error(NULL, "Failed to read the local address of the server");
+		return;
+	}
+
+#if HAVE_IPV6
+	if (((struct sockaddr *) &addr)->sa_family == AF_INET6) {
+		RETURN_LONG(ntohs(((struct sockaddr_in6 *) &addr)->sin6_port));
+	}
+#endif
+
+	RETURN_LONG(ntohs(((struct sockaddr_in *) &addr)->sin_port));
+}
+
+ZEND_METHOD(Server, close)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	concurrent_server_close((concurrent_server *) Z_OBJ_P(getThis()));
+}
+
+ZEND_METHOD(Server, __wakeup)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Unserialization of a server is not allowed");
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_server_ctor, 0, 0, 3)
+	ZEND_ARG_TYPE_INFO(0, host, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, port, IS_LONG, 0)
+	ZEND_ARG_CALLABLE_INFO(0, callback, 0)
+	ZEND_ARG_TYPE_INFO(0, max_in_flight, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, backlog, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_server_count, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_server_get_port, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_server_close, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_server_wakeup, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry server_functions[] = {
+	ZEND_ME(Server, __construct, arginfo_server_ctor, ZEND_ACC_PUBLIC | ZEND_ACC_CTOR)
+	ZEND_ME(Server, count, arginfo_server_count, ZEND_ACC_PUBLIC)
+	ZEND_ME(Server, getPort, arginfo_server_get_port, ZEND_ACC_PUBLIC)
+	ZEND_ME(Server, close, arginfo_server_close, ZEND_ACC_PUBLIC)
+	ZEND_ME(Server, __wakeup, arginfo_server_wakeup, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+void concurrent_server_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\Server", server_functions);
+	concurrent_server_ce = zend_register_internal_class(&ce);
+	concurrent_server_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_server_ce->create_object = concurrent_server_object_create;
+	concurrent_server_ce->serialize = zend_class_serialize_deny;
+	concurrent_server_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_server_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_server_handlers.free_obj = concurrent_server_object_destroy;
+	concurrent_server_handlers.clone_obj = NULL;
+
+	zend_class_implements(concurrent_server_ce, 1, zend_ce_countable);
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,224 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+#ifdef HAVE_SYS_SIGNALFD_H
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+#ifdef HAVE_SYS_SIGNALFD_H
+static const zend_uchar CONCURRENT_SIGNAL_WATCHER_BLOCKED_BEFORE = 1;
+static const zend_uchar CONCURRENT_SIGNAL_WATCHER_BLOCKED = 2;
+
+
+static void concurrent_signal_watcher_read(concurrent_io_watcher *io, int events)
+{
+	concurrent_signal_watcher *watcher;
+	concurrent_awaitable_cb *current;
+	struct signalfd_siginfo info[16];
+	ssize_t len;
+	size_t i;
+	uint32_t signo;
+
+	zval result;
+
+	watcher = (concurrent_signal_watcher *) io->object;
+
+	while (1) {
+		len = read(io->fd, info, sizeof(info));
+
+		if (len < (ssize_t) sizeof(struct signalfd_siginfo)) {
+			break;
+		}
+
+		for (i = 0; i < (size_t) len / sizeof(struct signalfd_siginfo); i++) {
+			signo = info[i].ssi_signo;
+
+			if (signo >= CONCURRENT_SIGNAL_WATCHER_MAX || watcher->queues[signo].first == NULL) {
+				continue;
+			}
+
+			for (current = watcher->queues[signo].first; current != NULL; current = current->next) {
+				watcher->waiting--;
+			}
+
+			ZVAL_LONG(&result, signo);
+
+			// Continuations only enqueue tasks, every waiting task is enqueued in the same batch.
+			concurrent_awaitable_trigger_continuation(&watcher->queues[signo], &result, 1);
+		}
+	}
+
+	// Nothing can be delivered without waiters, pending signals remain blocked until the next call to awaitSignal().
+	if (watcher->waiting == 0) {
+		concurrent_io_watcher_stop(io);
+	}
+}
+#endif
+
+zend_bool concurrent_signal_watcher_register(concurrent_task *task, zend_long signo)
+{
+#ifdef HAVE_SYS_SIGNALFD_H
+	concurrent_signal_watcher *watcher;
+	sigset_t set;
+	sigset_t prev;
+	int fd;
+	int i;
+
+	if (signo < 1 || signo >= CONCURRENT_SIGNAL_WATCHER_MAX || signo == SIGKILL || signo == SIGSTOP) {
+		zend_throw_error(NULL, "Cannot await invalid signal %d", (int) signo);
+		return 0;
+	}
+
+	watcher = TASK_G(signal_watcher);
+
+	if (watcher == NULL) {
+		watcher = emalloc(sizeof(concurrent_signal_watcher));
+		ZEND_SECURE_ZERO(watcher, sizeof(concurrent_signal_watcher));
+
+		watcher->io.fd = -1;
+		watcher->io.events = CONCURRENT_IO_WATCHER_READABLE;
+		watcher->io.func = concurrent_signal_watcher_read;
+		watcher->io.object = watcher;
+
+		TASK_G(signal_watcher) = watcher;
+	}
+
+	if (!watcher->blocked[signo]) {
+		sigemptyset(&set);
+		sigaddset(&set, (int) signo);
+
+		if (sigprocmask(SIG_BLOCK, &set, &prev) != 0) {
+			zend_throw_error(NULL, "Failed to block signal %d: %s", (int) signo, strerror(errno));
+			return 0;
+		}
+
+		watcher->blocked[signo] = sigismember(&prev, (int) signo) ? CONCURRENT_SIGNAL_WATCHER_BLOCKED_BEFORE : CONCURRENT_SIGNAL_WATCHER_BLOCKED;
+
+		sigemptyset(&set);
+
+		for (i = 1; i < CONCURRENT_SIGNAL_WATCHER_MAX; i++) {
+			if (watcher->blocked[i]) {
+				sigaddset(&set, i);
+			}
+		}
+
+		fd = signalfd(watcher->io.fd, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+
+		if (fd < 0) {
+			zend_throw_error(NULL, "Failed to create signal file descriptor: %s", strerror(errno));
+			return 0;
+		}
+
+		watcher->io.fd = fd;
+	}
+
+	concurrent_awaitable_append_continuation(&watcher->queues[signo], task, concurrent_task_continuation);
+
+	watcher->waiting++;
+
+	concurrent_io_watcher_start(&watcher->io);
+
+	return 1;
+#else
+	zend_throw_error(NULL, "Awaiting signals requires signalfd() which is not available on this platform");
+
+	return 0;
+#endif
+}
+
+/* Removes a task that has been unwound before the signal was delivered. */
+void concurrent_signal_watcher_unregister(concurrent_task *task, zend_long signo)
+{
+	concurrent_signal_watcher *watcher;
+
+	watcher = TASK_G(signal_watcher);
+
+	if (watcher == NULL || !concurrent_awaitable_remove_continuation(&watcher->queues[signo], task, concurrent_task_continuation)) {
+		return;
+	}
+
+	if (--watcher->waiting == 0) {
+		concurrent_io_watcher_stop(&watcher->io);
+	}
+}
+
+void concurrent_signal_watcher_shutdown()
+{
+	concurrent_signal_watcher *watcher;
+	int i;
+
+	watcher = TASK_G(signal_watcher);
+
+	if (watcher == NULL) {
+		return;
+	}
+
+	TASK_G(signal_watcher) = NULL;
+
+	concurrent_io_watcher_stop(&watcher->io);
+
+	for (i = 1; i < CONCURRENT_SIGNAL_WATCHER_MAX; i++) {
+		if (watcher->queues[i].first != NULL) {
+			concurrent_awaitable_dispose_continuation(&watcher->queues[i]);
+		}
+	}
+
+#ifdef HAVE_SYS_SIGNALFD_H
+	{
+		sigset_t set;
+
+		sigemptyset(&set);
+
+		for (i = 1; i < CONCURRENT_SIGNAL_WATCHER_MAX; i++) {
+			if (watcher->blocked[i] == CONCURRENT_SIGNAL_WATCHER_BLOCKED) {
+				sigaddset(&set, i);
+			}
+		}
+
+		sigprocmask(SIG_UNBLOCK, &set, NULL);
+	}
+
+	if (watcher->io.fd >= 0) {
+		close(watcher->io.fd);
+	}
+#endif
+
+	efree(watcher);
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,395 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "php_network.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+#include <errno.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+zend_class_entry *concurrent_socket_ce;
+
+static zend_object_handlers concurrent_socket_handlers;
+
+/* Minimum size of the receive buffer. */
+#define CONCURRENT_SOCKET_CHUNK_SIZE 8192
+
+
+static zend_bool concurrent_socket_fill(concurrent_socket *socket, size_t size, zend_execute_data *execute_data)
+{
+	ssize_t len;
+
+	if (socket->buffer == NULL) {
+		socket->buffer = zend_string_alloc(MAX(size, CONCURRENT_SOCKET_CHUNK_SIZE), 0);
+	} else if (ZSTR_LEN(socket->buffer) < size) {
+		socket->buffer = zend_string_realloc(socket->buffer, size, 0);
+	}
+
+	socket->offset = 0;
+	socket->length = 0;
+
+	while (1) {
+		len = recv(socket->fd, ZSTR_VAL(socket->buffer), ZSTR_LEN(socket->buffer), 0);
+
+		if (len >= 0) {
+			socket->length = (size_t) len;
+
+			return 1;
+		}
+
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			if (!concurrent_io_watcher_await(socket->fd, CONCURRENT_IO_WATCHER_READABLE, execute_data)) {
+				return 0;
+			}
+		} else if (errno != EINTR) {
+			zend_throw_error(NULL, "Failed to read from socket: %s", strerror(errno));
+			return 0;
+		}
+	}
+}
+
+static void concurrent_socket_close(concurrent_socket *socket)
+{
+	if (socket->closed) {
+		return;
+	}
+
+	socket->closed = 1;
+
+	zend_list_close(Z_RES(socket->stream));
+}
+
+
+static zend_object *concurrent_socket_object_create(zend_class_entry *ce)
+{
+	concurrent_socket *socket;
+
+	socket = emalloc(sizeof(concurrent_socket));
+	ZEND_SECURE_ZERO(socket, sizeof(concurrent_socket));
+
+	socket->fd = -1;
+	socket->closed = 1;
+
+	ZVAL_UNDEF(&socket->stream);
+
+	zend_object_std_init(&socket->std, ce);
+	socket->std.handlers = &concurrent_socket_handlers;
+
+	return &socket->std;
+}
+
+static void concurrent_socket_object_destroy(zend_object *object)
+{
+	concurrent_socket *socket;
+
+	socket = (concurrent_socket *) object;
+
+	if (socket->buffer != NULL) {
+		zend_string_release(socket->buffer);
+	}
+
+	zval_ptr_dtor(&socket->stream);
+
+	zend_object_std_dtor(&socket->std);
+}
+
+ZEND_METHOD(Socket, __construct)
+{
+	concurrent_socket *socket;
+	php_stream *stream;
+	php_socket_t fd;
+	size_t len;
+
+	zval *val;
+
+	socket = (concurrent_socket *) Z_OBJ_P(getThis());
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_RESOURCE(val)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (Z_TYPE(socket->stream) != IS_UNDEF) {
+		zend_throw_error(NULL, "Socket must not be constructed more than once");
+		return;
+	}
+
+	php_stream_from_zval_no_verify(stream, val);
+
+	if (stream == NULL) {
+		zend_throw_error(NULL, "Socket requires a stream resource");
+		return;
+	}
+
+	if (php_stream_cast(stream, PHP_STREAM_AS_SOCKETD | PHP_STREAM_CAST_INTERNAL, (void **) &fd, 0) != SUCCESS) {
+		zend_throw_error(NULL, "Stream cannot be represented as a native socket");
+		return;
+	}
+
+	php_stream_set_option(stream, PHP_STREAM_OPTION_BLOCKING, 0, NULL);
+
+	ZVAL_COPY(&socket->stream, val);
+
+	socket->fd = (int) fd;
+	socket->closed = 0;
+
+	// Take over data that has already been read into the stream buffer.
+	len = (size_t) (stream->writepos - stream->readpos);
+
+	if (len > 0) {
+		socket->buffer = zend_string_alloc(MAX(len, CONCURRENT_SOCKET_CHUNK_SIZE), 0);
+		socket->length = len;
+
+		memcpy(ZSTR_VAL(socket->buffer), stream->readbuf + stream->readpos, len);
+
+		stream->readpos = stream->writepos;
+	}
+}
+
+/* {{{ proto ?string Socket::read(int $length = 8192) */
+ZEND_METHOD(Socket, read)
+{
+	concurrent_socket *socket;
+	zend_string *str;
+	zend_long length;
+	size_t len;
+
+	length = CONCURRENT_SOCKET_CHUNK_SIZE;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(length)
+	ZEND_PARSE_PARAMETERS_END();
+
+	socket = (concurrent_socket *) Z_OBJ_P(getThis());
+
+	if (socket->closed) {
+		zend_throw_error(NULL, "Cannot read from a closed socket");
+		return;
+	}
+
+	if (length < 1) {
+		zend_throw_error(NULL, "Length must be greater than zero");
+		return;
+	}
+
+	if (socket->length == 0) {
+		if (!concurrent_socket_fill(socket, (size_t) length, execute_data)) {
+			return;
+		}
+
+		if (socket->length == 0) {
+			RETURN_NULL();
+		}
+	}
+
+	len = MIN((size_t) length, socket->length);
+
+	// Hand off the receive buffer if it is consumed at once and would otherwise be mostly copied, the next fill
+	// allocates a new buffer. Strings cannot share the buffer, partial reads have to be copied.
+	if (socket->offset == 0 && len == socket->length && len >= ZSTR_LEN(socket->buffer) / 2) {
+		str = zend_string_truncate(socket->buffer, len, 0);
+		ZSTR_VAL(str)[len] = '\0';
+
+		socket->buffer = NULL;
+		socket->length = 0;
+
+		RETURN_NEW_STR(str);
+	}
+
+	RETVAL_STRINGL(ZSTR_VAL(socket->buffer) + socket->offset, len);
+
+	socket->offset += len;
+	socket->length -= len;
+}
+/* }}} */
+
+/* {{{ proto int Socket::write(string ...$data) */
+ZEND_METHOD(Socket, write)
+{
+	concurrent_socket *socket;
+	struct iovec *iov;
+	struct msghdr msg;
+	uint32_t count;
+	uint32_t i;
+	size_t total;
+	ssize_t len;
+
+	zval *params;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, -1)
+		Z_PARAM_VARIADIC('+', params, count)
+	ZEND_PARSE_PARAMETERS_END();
+
+	socket = (concurrent_socket *) Z_OBJ_P(getThis());
+
+	if (socket->closed) {
+		zend_throw_error(NULL, "Cannot write to a closed socket");
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (Z_TYPE(params[i]) != IS_STRING) {
+			zend_throw_error(zend_ce_type_error, "Socket data must be passed as strings");
+			return;
+		}
+	}
+
+	// Strings are referenced by the call frame while the task is suspended, no need to copy them.
+	iov = safe_emalloc(count, sizeof(struct iovec), 0);
+	total = 0;
+
+	for (i = 0; i < count; i++) {
+		iov[i].iov_base = Z_STRVAL(params[i]);
+		iov[i].iov_len = Z_STRLEN(params[i]);
+
+		total += Z_STRLEN(params[i]);
+	}
+
+	ZEND_SECURE_ZERO(&msg, sizeof(struct msghdr));
+
+	i = 0;
+
+	while (i < count) {
+		if (iov[i].iov_len == 0) {
+			i++;
+			continue;
+		}
+
+		msg.msg_iov = iov + i;
+		msg.msg_iovlen = MIN(count - i, IOV_MAX);
+
+		len = sendmsg(socket->fd, &msg, MSG_NOSIGNAL);
+
+		if (len < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				if (!concurrent_io_watcher_await(socket->fd, CONCURRENT_IO_WATCHER_WRITABLE, execute_data)) {
+					break;
+				}
+			} else if (errno != EINTR) {
+				zend_throw_error(NULL, "Failed to write to socket: %s", strerror(errno));
+				break;
+			}
+
+			continue;
+		}
+
+		while (len > 0) {
+			if ((size_t) len >= iov[i].iov_len) {
+				len -= iov[i].iov_len;
+				i++;
+			} else {
+				iov[i].iov_base = (char *) iov[i].iov_base + len;
+				iov[i].iov_len -= len;
+				len = 0;
+			}
+		}
+	}
+
+	efree(iov);
+
+	if (EG(exception)) {
+		return;
+	}
+
+	RETURN_LONG((zend_long) total);
+}
+/* }}} */
+
+ZEND_METHOD(Socket, close)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	concurrent_socket_close((concurrent_socket *) Z_OBJ_P(getThis()));
+}
+
+ZEND_METHOD(Socket, __wakeup)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Unserialization of a socket is not allowed");
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_socket_ctor, 0, 0, 1)
+	ZEND_ARG_INFO(0, stream)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_socket_read, 0, 0, IS_STRING, 1)
+	ZEND_ARG_TYPE_INFO(0, length, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_socket_write, 0, 1, IS_LONG, 0)
+	ZEND_ARG_VARIADIC_TYPE_INFO(0, data, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_socket_close, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_socket_wakeup, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry socket_functions[] = {
+	ZEND_ME(Socket, __construct, arginfo_socket_ctor, ZEND_ACC_PUBLIC | ZEND_ACC_CTOR)
+	ZEND_ME(Socket, read, arginfo_socket_read, ZEND_ACC_PUBLIC)
+	ZEND_ME(Socket, write, arginfo_socket_write, ZEND_ACC_PUBLIC)
+	ZEND_ME(Socket, close, arginfo_socket_close, ZEND_ACC_PUBLIC)
+	ZEND_ME(Socket, __wakeup, arginfo_socket_wakeup, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+void concurrent_socket_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\Socket", socket_functions);
+	concurrent_socket_ce = zend_register_internal_class(&ce);
+	concurrent_socket_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_socket_ce->create_object = concurrent_socket_object_create;
+	concurrent_socket_ce->serialize = zend_class_serialize_deny;
+	concurrent_socket_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_socket_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_socket_handlers.free_obj = concurrent_socket_object_destroy;
+	concurrent_socket_handlers.clone_obj = NULL;
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
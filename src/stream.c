@@ -0,0 +1,392 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_SPLICE) && defined(HAVE_SYS_SENDFILE_H)
+#define CONCURRENT_STREAM_SPLICE 1
+#include <sys/sendfile.h>
+#endif
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+zend_class_entry *concurrent_stream_ce;
+
+/* Max number of bytes being moved by a single system call. */
+#define CONCURRENT_STREAM_CHUNK_SIZE 65536
+
+
+static size_t concurrent_stream_chunk(zend_long length, size_t total)
+{
+	if (length < 0 || (size_t) length - total > CONCURRENT_STREAM_CHUNK_SIZE) {
+		return CONCURRENT_STREAM_CHUNK_SIZE;
+	}
+
+	return (size_t) length - total;
+}
+
+/* Checks the result of a system call, suspends the task if the descriptor would block, returns 0 on error. */
+static zend_bool concurrent_stream_check(ssize_t len, int fd, int events, const char *op, zend_execute_data *execute_data)
+{
+	if (len >= 0 || errno == EINTR) {
+		return 1;
+	}
+
+	if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		return concurrent_io_watcher_await(fd, events, execute_data);
+	}
+
+	zend_throw_error(NULL, "Failed to %s stream: %s", op, strerror(errno));
+
+	return 0;
+}
+
+static zend_bool concurrent_stream_write_all(int fd, char *buf, size_t len, zend_execute_data *execute_data)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, buf, len);
+
+		if (!concurrent_stream_check(n, fd, CONCURRENT_IO_WATCHER_WRITABLE, "write to", execute_data)) {
+			return 0;
+		}
+
+		if (n > 0) {
+			buf += n;
+			len -= (size_t) n;
+		}
+	}
+
+	return 1;
+}
+
+#ifdef CONCURRENT_STREAM_SPLICE
+static zend_bool concurrent_stream_sendfile(int from, int to, zend_long length, size_t *total, zend_execute_data *execute_data)
+{
+	ssize_t n;
+
+	while (length < 0 || *total < (size_t) length) {
+		n = sendfile(to, from, NULL, concurrent_stream_chunk(length, *total));
+
+		if (n == 0) {
+			break;
+		}
+
+		if (!concurrent_stream_check(n, to, CONCURRENT_IO_WATCHER_WRITABLE, "send to", execute_data)) {
+			return 0;
+		}
+
+		if (n > 0) {
+			*total += (size_t) n;
+		}
+	}
+
+	return 1;
+}
+
+static zend_bool concurrent_stream_splice(int from, int to, zend_long length, size_t *total, zend_execute_data *execute_data)
+{
+	zend_bool result;
+	size_t buffered;
+	ssize_t n;
+	int pipes[2];
+
+	// Bytes are moved into a pipe and from the pipe into the target descriptor without leaving the kernel.
+	if (pipe2(pipes, O_NONBLOCK | O_CLOEXEC) != 0) {
+		zend_throw_error(NULL, "Failed to create pipe: %s", strerror(errno));
+		return 0;
+	}
+
+	result = 1;
+	buffered = 0;
+
+	while (1) {
+		if (buffered == 0) {
+			if (length >= 0 && *total >= (size_t) length) {
+				break;
+			}
+
+			n = splice(from, NULL, pipes[1], NULL, concurrent_stream_chunk(length, *total), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+			if (n == 0) {
+				break;
+			}
+
+			if (!concurrent_stream_check(n, from, CONCURRENT_IO_WATCHER_READABLE, "read from", execute_data)) {
+				result = 0;
+				break;
+			}
+
+			if (n > 0) {
+				buffered = (size_t) n;
+			}
+
+			continue;
+		}
+
+		n = splice(pipes[0], NULL, to, NULL, buffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+		if (!concurrent_stream_check(n, to, CONCURRENT_IO_WATCHER_WRITABLE, "write to", execute_data)) {
+			result = 0;
+			break;
+		}
+
+		if (n > 0) {
+			buffered -= (size_t) n;
+			*total += (size_t) n;
+		}
+	}
+
+	close(pipes[0]);
+	close(pipes[1]);
+
+	return result;
+}
+#else
+static zend_bool concurrent_stream_copy(int from, int to, zend_long length, size_t *total, zend_execute_data *execute_data)
+{
+	char buf[8192];
+	ssize_t n;
+
+	while (length < 0 || *total < (size_t) length) {
+		n = read(from, buf, MIN(sizeof(buf), concurrent_stream_chunk(length, *total)));
+
+		if (n == 0) {
+			break;
+		}
+
+		if (!concurrent_stream_check(n, from, CONCURRENT_IO_WATCHER_READABLE, "read from", execute_data)) {
+			return 0;
+		}
+
+		if (n > 0) {
+			if (!concurrent_stream_write_all(to, buf, (size_t) n, execute_data)) {
+				return 0;
+			}
+
+			*total += (size_t) n;
+		}
+	}
+
+	return 1;
+}
+#endif
+
+static php_stream *concurrent_stream_fetch(zval *val, int *fd)
+{
+	php_stream *stream;
+	php_socket_t sock;
+
+	php_stream_from_zval_no_verify(stream, val);
+
+	if (stream == NULL) {
+		zend_throw_error(NULL, "Transfer requires stream resources");
+		return NULL;
+	}
+
+	if (stream->readfilters.head != NULL || stream->writefilters.head != NULL) {
+		zend_throw_error(NULL, "Cannot transfer data using a stream that has filters attached");
+		return NULL;
+	}
+
+	if (php_stream_cast(stream, PHP_STREAM_AS_FD | PHP_STREAM_CAST_INTERNAL, (void **) fd, 0) == SUCCESS) {
+		return stream;
+	}
+
+	if (php_stream_cast(stream, PHP_STREAM_AS_SOCKETD | PHP_STREAM_CAST_INTERNAL, (void **) &sock, 0) == SUCCESS) {
+		*fd = (int) sock;
+
+		return stream;
+	}
+
+	zend_throw_error(NULL, "Stream cannot be represented as a native file descriptor");
+
+	return NULL;
+}
+
+ZEND_METHOD(Stream, __construct)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Stream must not be constructed from userland code");
+}
+
+/* {{{ proto int Stream::transfer($from, $to, ?int $length = null) */
+ZEND_METHOD(Stream, transfer)
+{
+	php_stream *in;
+	php_stream *out;
+#ifdef CONCURRENT_STREAM_SPLICE
+	struct stat st;
+#endif
+	zend_long length;
+	zend_bool is_null;
+	zend_bool result;
+	size_t total;
+	size_t len;
+	int from;
+	int to;
+	int from_flags;
+	int to_flags;
+	char buf[8192];
+
+	zval *a;
+	zval *b;
+
+	length = -1;
+	is_null = 1;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 2, 3)
+		Z_PARAM_RESOURCE(a)
+		Z_PARAM_RESOURCE(b)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG_EX(length, is_null, 1, 0)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (is_null) {
+		length = -1;
+	} else if (length < 0) {
+		zend_throw_error(NULL, "Transfer length must not be negative");
+		return;
+	}
+
+	in = concurrent_stream_fetch(a, &from);
+
+	if (in == NULL) {
+		return;
+	}
+
+	out = concurrent_stream_fetch(b, &to);
+
+	if (out == NULL) {
+		return;
+	}
+
+	php_stream_flush(out);
+
+	total = 0;
+	result = 1;
+
+	from_flags = fcntl(from, F_GETFL);
+
+	if (UNEXPECTED(from_flags == -1 || (to_flags = fcntl(to, F_GETFL)) == -1)) {
+		zend_throw_error(NULL, "Failed to read stream flags: %s", strerror(errno));
+		return;
+	}
+
+	fcntl(from, F_SETFL, from_flags | O_NONBLOCK);
+	fcntl(to, F_SETFL, to_flags | O_NONBLOCK);
+
+	// Data that has already been read into the stream buffer has to be written first.
+	while (in->writepos > in->readpos && (length < 0 || total < (size_t) length)) {
+		len = php_stream_read(in, buf, MIN(sizeof(buf), MIN((size_t) (in->writepos - in->readpos), concurrent_stream_chunk(length, total))));
+
+		if (len == 0) {
+			break;
+		}
+
+		if (!concurrent_stream_write_all(to, buf, len, execute_data)) {
+			result = 0;
+			break;
+		}
+
+		total += len;
+	}
+
+	if (result) {
+		len = total;
+
+#ifdef CONCURRENT_STREAM_SPLICE
+		if (fstat(from, &st) == 0 && S_ISREG(st.st_mode)) {
+			result = concurrent_stream_sendfile(from, to, length, &total, execute_data);
+		} else {
+			result = concurrent_stream_splice(from, to, length, &total, execute_data);
+		}
+#else
+		result = concurrent_stream_copy(from, to, length, &total, execute_data);
+#endif
+
+		// Bytes have been moved using the descriptor, keep stream positions in sync.
+		in->position += (zend_off_t) (total - len);
+	}
+
+	out->position += (zend_off_t) total;
+
+	fcntl(from, F_SETFL, from_flags);
+	fcntl(to, F_SETFL, to_flags);
+
+	if (!result) {
+		return;
+	}
+
+	RETURN_LONG((zend_long) total);
+}
+/* }}} */
+
+ZEND_BEGIN_ARG_INFO(arginfo_stream_ctor, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_stream_transfer, 0, 2, IS_LONG, 0)
+	ZEND_ARG_INFO(0, from)
+	ZEND_ARG_INFO(0, to)
+	ZEND_ARG_TYPE_INFO(0, length, IS_LONG, 1)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry stream_functions[] = {
+	ZEND_ME(Stream, __construct, arginfo_stream_ctor, ZEND_ACC_PRIVATE | ZEND_ACC_CTOR)
+	ZEND_ME(Stream, transfer, arginfo_stream_transfer, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+	ZEND_FE_END
+};
+
+
+void concurrent_stream_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\Stream", stream_functions);
+	concurrent_stream_ce = zend_register_internal_class(&ce);
+	concurrent_stream_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_stream_ce->serialize = zend_class_serialize_deny;
+	concurrent_stream_ce->unserialize = zend_class_unserialize_deny;
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
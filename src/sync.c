@@ -0,0 +1,573 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+zend_class_entry *concurrent_mutex_ce;
+zend_class_entry *concurrent_semaphore_ce;
+zend_class_entry *concurrent_condition_ce;
+
+static zend_object_handlers concurrent_mutex_handlers;
+static zend_object_handlers concurrent_semaphore_handlers;
+static zend_object_handlers concurrent_condition_handlers;
+
+
+/* Releases the lock by handing ownership to the next waiting task, only this task will be scheduled. */
+static void concurrent_mutex_release(concurrent_mutex *mutex)
+{
+	concurrent_task_waiter *waiter;
+
+	zval result;
+
+	waiter = concurrent_task_wait_queue_shift(&mutex->waiters);
+
+	if (waiter == NULL) {
+		mutex->owner = NULL;
+		mutex->locked = 0;
+
+		return;
+	}
+
+	mutex->owner = waiter->task;
+
+	ZVAL_NULL(&result);
+	concurrent_task_continuation(waiter->task, &result, 1);
+}
+
+static zend_object *concurrent_mutex_object_create(zend_class_entry *ce)
+{
+	concurrent_mutex *mutex;
+
+	mutex = emalloc(sizeof(concurrent_mutex));
+	ZEND_SECURE_ZERO(mutex, sizeof(concurrent_mutex));
+
+	zend_object_std_init(&mutex->std, ce);
+	mutex->std.handlers = &concurrent_mutex_handlers;
+
+	return &mutex->std;
+}
+
+static void concurrent_mutex_object_destroy(zend_object *object)
+{
+	concurrent_mutex *mutex;
+
+	mutex = (concurrent_mutex *) object;
+
+	concurrent_task_wait_queue_fail(&mutex->waiters, "Mutex has been disposed");
+
+	zend_object_std_dtor(&mutex->std);
+}
+
+ZEND_METHOD(Mutex, lock)
+{
+	concurrent_mutex *mutex;
+	concurrent_task_waiter waiter;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	mutex = (concurrent_mutex *) Z_OBJ_P(getThis());
+
+	ZEND_SECURE_ZERO(&waiter, sizeof(concurrent_task_waiter));
+
+	waiter.task = concurrent_task_get_current();
+
+	// Tasks that are being unwound can still lock a mutex that is not locked (but they cannot wait for it).
+	if (!mutex->locked) {
+		mutex->owner = concurrent_task_get_active();
+		mutex->locked = 1;
+
+		return;
+	}
+
+	if (waiter.task == NULL) {
+		zend_throw_error(NULL, "Cannot wait for a mutex outside of a running task");
+		return;
+	}
+
+	if (mutex->owner == waiter.task) {
+		zend_throw_error(NULL, "Mutex is already locked by the current task");
+		return;
+	}
+
+	concurrent_task_wait(&mutex->waiters, &waiter, NULL, execute_data);
+
+	// Do not keep a lock that has been handed to a task that is being destroyed.
+	if (UNEXPECTED(EG(exception)) && mutex->locked && mutex->owner == waiter.task) {
+		concurrent_mutex_release(mutex);
+	}
+}
+
+ZEND_METHOD(Mutex, tryLock)
+{
+	concurrent_mutex *mutex;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	mutex = (concurrent_mutex *) Z_OBJ_P(getThis());
+
+	if (mutex->locked) {
+		RETURN_FALSE;
+	}
+
+	mutex->owner = concurrent_task_get_active();
+	mutex->locked = 1;
+
+	RETURN_TRUE;
+}
+
+ZEND_METHOD(Mutex, unlock)
+{
+	concurrent_mutex *mutex;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	mutex = (concurrent_mutex *) Z_OBJ_P(getThis());
+
+	if (!mutex->locked) {
+		zend_throw_error(NULL, "Cannot unlock a mutex that is not locked");
+		return;
+	}
+
+	// Ownership does not depend on the status of the task, a cancelled task must be able to unlock while it is unwound.
+	if (mutex->owner != concurrent_task_get_active()) {
+		zend_throw_error(NULL, "Cannot unlock a mutex that is locked by another task");
+		return;
+	}
+
+	concurrent_mutex_release(mutex);
+}
+
+ZEND_METHOD(Mutex, isLocked)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	RETURN_BOOL(((concurrent_mutex *) Z_OBJ_P(getThis()))->locked);
+}
+
+ZEND_METHOD(Mutex, __wakeup)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Unserialization of a mutex is not allowed");
+}
+
+ZEND_BEGIN_ARG_INFO(arginfo_mutex_lock, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_mutex_try_lock, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_mutex_unlock, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_mutex_is_locked, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_mutex_wakeup, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry mutex_functions[] = {
+	ZEND_ME(Mutex, lock, arginfo_mutex_lock, ZEND_ACC_PUBLIC)
+	ZEND_ME(Mutex, tryLock, arginfo_mutex_try_lock, ZEND_ACC_PUBLIC)
+	ZEND_ME(Mutex, unlock, arginfo_mutex_unlock, ZEND_ACC_PUBLIC)
+	ZEND_ME(Mutex, isLocked, arginfo_mutex_is_locked, ZEND_ACC_PUBLIC)
+	ZEND_ME(Mutex, __wakeup, arginfo_mutex_wakeup, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+/* Releases a permit by handing it to the next waiting task, the permit is only returned if no task is waiting. */
+static void concurrent_semaphore_release(concurrent_semaphore *sem)
+{
+	concurrent_task_waiter *waiter;
+
+	zval result;
+
+	waiter = concurrent_task_wait_queue_shift(&sem->waiters);
+
+	if (waiter == NULL) {
+		sem->permits++;
+
+		return;
+	}
+
+	ZVAL_TRUE(waiter->value);
+
+	ZVAL_NULL(&result);
+	concurrent_task_continuation(waiter->task, &result, 1);
+}
+
+static zend_object *concurrent_semaphore_object_create(zend_class_entry *ce)
+{
+	concurrent_semaphore *sem;
+
+	sem = emalloc(sizeof(concurrent_semaphore));
+	ZEND_SECURE_ZERO(sem, sizeof(concurrent_semaphore));
+
+	zend_object_std_init(&sem->std, ce);
+	sem->std.handlers = &concurrent_semaphore_handlers;
+
+	return &sem->std;
+}
+
+static void concurrent_semaphore_object_destroy(zend_object *object)
+{
+	concurrent_semaphore *sem;
+
+	sem = (concurrent_semaphore *) object;
+
+	concurrent_task_wait_queue_fail(&sem->waiters, "Semaphore has been disposed");
+
+	zend_object_std_dtor(&sem->std);
+}
+
+ZEND_METHOD(Semaphore, __construct)
+{
+	concurrent_semaphore *sem;
+	zend_long permits;
+
+	permits = 1;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(permits)
+	ZEND_PARSE_PARAMETERS_END();
+
+	sem = (concurrent_semaphore *) Z_OBJ_P(getThis());
+
+	if (permits < 0) {
+		zend_throw_error(NULL, "Invalid number of semaphore permits " ZEND_LONG_FMT, permits);
+		return;
+	}
+
+	sem->permits = permits;
+}
+
+ZEND_METHOD(Semaphore, acquire)
+{
+	concurrent_semaphore *sem;
+	concurrent_task_waiter waiter;
+
+	zval granted;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	sem = (concurrent_semaphore *) Z_OBJ_P(getThis());
+
+	if (sem->permits > 0) {
+		sem->permits--;
+
+		return;
+	}
+
+	ZEND_SECURE_ZERO(&waiter, sizeof(concurrent_task_waiter));
+	ZVAL_FALSE(&granted);
+
+	waiter.task = concurrent_task_get_current();
+	waiter.value = &granted;
+
+	if (waiter.task == NULL) {
+		zend_throw_error(NULL, "Cannot wait for a semaphore permit outside of a running task");
+		return;
+	}
+
+	concurrent_task_wait(&sem->waiters, &waiter, NULL, execute_data);
+
+	// Pass on a permit that has been handed to a task that is being destroyed.
+	if (UNEXPECTED(EG(exception)) && Z_TYPE(granted) == IS_TRUE) {
+		concurrent_semaphore_release(sem);
+	}
+}
+
+ZEND_METHOD(Semaphore, tryAcquire)
+{
+	concurrent_semaphore *sem;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	sem = (concurrent_semaphore *) Z_OBJ_P(getThis());
+
+	if (sem->permits < 1) {
+		RETURN_FALSE;
+	}
+
+	sem->permits--;
+
+	RETURN_TRUE;
+}
+
+ZEND_METHOD(Semaphore, release)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	// Hand the permit directly to the next waiter, it must not be taken by a task that did not wait.
+	concurrent_semaphore_release((concurrent_semaphore *) Z_OBJ_P(getThis()));
+}
+
+ZEND_METHOD(Semaphore, available)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	RETURN_LONG(((concurrent_semaphore *) Z_OBJ_P(getThis()))->permits);
+}
+
+ZEND_METHOD(Semaphore, __wakeup)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Unserialization of a semaphore is not allowed");
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_semaphore_ctor, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, permits, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_semaphore_acquire, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_semaphore_try_acquire, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_semaphore_release, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_semaphore_available, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_semaphore_wakeup, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry semaphore_functions[] = {
+	ZEND_ME(Semaphore, __construct, arginfo_semaphore_ctor, ZEND_ACC_PUBLIC | ZEND_ACC_CTOR)
+	ZEND_ME(Semaphore, acquire, arginfo_semaphore_acquire, ZEND_ACC_PUBLIC)
+	ZEND_ME(Semaphore, tryAcquire, arginfo_semaphore_try_acquire, ZEND_ACC_PUBLIC)
+	ZEND_ME(Semaphore, release, arginfo_semaphore_release, ZEND_ACC_PUBLIC)
+	ZEND_ME(Semaphore, available, arginfo_semaphore_available, ZEND_ACC_PUBLIC)
+	ZEND_ME(Semaphore, __wakeup, arginfo_semaphore_wakeup, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+/*
+ * Wakes a task waiting for the condition. The waiter is moved into the wait queue of its mutex if the mutex is
+ * locked, the task will not be scheduled before it owns the mutex again.
+ */
+static void concurrent_condition_notify(concurrent_task_waiter *waiter)
+{
+	concurrent_mutex *mutex;
+
+	zval result;
+
+	mutex = (concurrent_mutex *) Z_OBJ_P(waiter->value);
+
+	if (mutex->locked) {
+		concurrent_task_wait_queue_push(&mutex->waiters, waiter);
+
+		return;
+	}
+
+	mutex->owner = waiter->task;
+	mutex->locked = 1;
+
+	ZVAL_NULL(&result);
+	concurrent_task_continuation(waiter->task, &result, 1);
+}
+
+static zend_object *concurrent_condition_object_create(zend_class_entry *ce)
+{
+	concurrent_condition *cond;
+
+	cond = emalloc(sizeof(concurrent_condition));
+	ZEND_SECURE_ZERO(cond, sizeof(concurrent_condition));
+
+	zend_object_std_init(&cond->std, ce);
+	cond->std.handlers = &concurrent_condition_handlers;
+
+	return &cond->std;
+}
+
+static void concurrent_condition_object_destroy(zend_object *object)
+{
+	concurrent_condition *cond;
+
+	cond = (concurrent_condition *) object;
+
+	concurrent_task_wait_queue_fail(&cond->waiters, "Condition has been disposed");
+
+	zend_object_std_dtor(&cond->std);
+}
+
+ZEND_METHOD(Condition, wait)
+{
+	concurrent_condition *cond;
+	concurrent_mutex *mutex;
+	concurrent_task_waiter waiter;
+
+	zval *val;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_OBJECT_OF_CLASS(val, concurrent_mutex_ce)
+	ZEND_PARSE_PARAMETERS_END();
+
+	cond = (concurrent_condition *) Z_OBJ_P(getThis());
+	mutex = (concurrent_mutex *) Z_OBJ_P(val);
+
+	ZEND_SECURE_ZERO(&waiter, sizeof(concurrent_task_waiter));
+
+	if (!mutex->locked || mutex->owner != concurrent_task_get_active()) {
+		zend_throw_error(NULL, "Cannot wait for a condition without owning the mutex");
+		return;
+	}
+
+	waiter.task = concurrent_task_get_current();
+	waiter.value = val;
+
+	if (waiter.task == NULL) {
+		zend_throw_error(NULL, "Cannot wait for a condition outside of a running task");
+		return;
+	}
+
+	concurrent_mutex_release(mutex);
+
+	// The mutex is owned by the task again when it is continued, the mutex is kept alive by the call frame.
+	concurrent_task_wait(&cond->waiters, &waiter, NULL, execute_data);
+
+	if (UNEXPECTED(EG(exception)) && mutex->locked && mutex->owner == waiter.task) {
+		concurrent_mutex_release(mutex);
+	}
+}
+
+ZEND_METHOD(Condition, notifyOne)
+{
+	concurrent_condition *cond;
+	concurrent_task_waiter *waiter;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	cond = (concurrent_condition *) Z_OBJ_P(getThis());
+
+	waiter = concurrent_task_wait_queue_shift(&cond->waiters);
+
+	if (waiter == NULL) {
+		RETURN_FALSE;
+	}
+
+	concurrent_condition_notify(waiter);
+
+	RETURN_TRUE;
+}
+
+ZEND_METHOD(Condition, notifyAll)
+{
+	concurrent_condition *cond;
+	concurrent_task_waiter *waiter;
+	zend_long count;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	cond = (concurrent_condition *) Z_OBJ_P(getThis());
+	count = 0;
+
+	while ((waiter = concurrent_task_wait_queue_shift(&cond->waiters)) != NULL) {
+		concurrent_condition_notify(waiter);
+		count++;
+	}
+
+	RETURN_LONG(count);
+}
+
+ZEND_METHOD(Condition, __wakeup)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Unserialization of a condition is not allowed");
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_condition_wait, 0, 0, 1)
+	ZEND_ARG_OBJ_INFO(0, mutex, Concurrent\\Mutex, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_condition_notify_one, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_condition_notify_all, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_condition_wakeup, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry condition_functions[] = {
+	ZEND_ME(Condition, wait, arginfo_condition_wait, ZEND_ACC_PUBLIC)
+	ZEND_ME(Condition, notifyOne, arginfo_condition_notify_one, ZEND_ACC_PUBLIC)
+	ZEND_ME(Condition, notifyAll, arginfo_condition_notify_all, ZEND_ACC_PUBLIC)
+	ZEND_ME(Condition, __wakeup, arginfo_condition_wakeup, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+void concurrent_sync_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\Mutex", mutex_functions);
+	concurrent_mutex_ce = zend_register_internal_class(&ce);
+	concurrent_mutex_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_mutex_ce->create_object = concurrent_mutex_object_create;
+	concurrent_mutex_ce->serialize = zend_class_serialize_deny;
+	concurrent_mutex_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_mutex_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_mutex_handlers.free_obj = concurrent_mutex_object_destroy;
+	concurrent_mutex_handlers.clone_obj = NULL;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\Semaphore", semaphore_functions);
+	concurrent_semaphore_ce = zend_register_internal_class(&ce);
+	concurrent_semaphore_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_semaphore_ce->create_object = concurrent_semaphore_object_create;
+	concurrent_semaphore_ce->serialize = zend_class_serialize_deny;
+	concurrent_semaphore_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_semaphore_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_semaphore_handlers.free_obj = concurrent_semaphore_object_destroy;
+	concurrent_semaphore_handlers.clone_obj = NULL;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\Condition", condition_functions);
+	concurrent_condition_ce = zend_register_internal_class(&ce);
+	concurrent_condition_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_condition_ce->create_object = concurrent_condition_object_create;
+	concurrent_condition_ce->serialize = zend_class_serialize_deny;
+	concurrent_condition_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_condition_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_condition_handlers.free_obj = concurrent_condition_object_destroy;
+	concurrent_condition_handlers.clone_obj = NULL;
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -35,6 +35,10 @@ const zend_uchar CONCURRENT_TASK_OPERATION_NONE = 0;
 const zend_uchar CONCURRENT_TASK_OPERATION_START = 1;
 const zend_uchar CONCURRENT_TASK_OPERATION_RESUME = 2;
 
+static const zend_uchar CONCURRENT_TASK_COMBINATOR_ALL = 0;
+static const zend_uchar CONCURRENT_TASK_COMBINATOR_ANY = 1;
+static const zend_uchar CONCURRENT_TASK_COMBINATOR_FIRST_SUCCESSFUL = 2;
+
 static zend_object_handlers concurrent_task_handlers;
 
 
@@ -42,6 +46,14 @@ void concurrent_task_start(concurrent_task *task)
 {
 	concurrent_context *context;
 
+	if (task->context->token != NULL) {
+		concurrent_cancellation_token_attach(task->context->token, task);
+
+		if (task->fiber.status == CONCURRENT_FIBER_STATUS_DEAD) {
+			return;
+		}
+	}
+
 	task->operation = CONCURRENT_TASK_OPERATION_NONE;
 	task->fiber.context = concurrent_fiber_create_context();
 
@@ -84,7 +96,85 @@ void concurrent_task_continue(concurrent_task *task)
 	}
 }
 
-static void concurrent_task_continuation(void *obj, zval *result, zend_bool success)
+void concurrent_task_suspend(concurrent_task *task, zval *return_value, zend_execute_data *execute_data)
+{
+	concurrent_context *context;
+	size_t stack_page_size;
+
+	zval *value;
+	zval error;
+
+	// Transform callbacks run on the stack of the task that resolves the source awaitable, that task cannot wait.
+	if (UNEXPECTED(TASK_G(transform_fiber) == &task->fiber)) {
+		zend_throw_error(NULL, "Cannot suspend a task from within an awaitable transform callback, return an awaitable instead");
+		return;
+	}
+
+	// Tasks that could not be unwound when they were cancelled fail at their next suspension point.
+	if (task->context->token != NULL && Z_TYPE_P(&task->context->token->error) != IS_UNDEF) {
+		Z_ADDREF_P(&task->context->token->error);
+
+		execute_data->opline--;
+		zend_throw_exception_internal(&task->context->token->error);
+		execute_data->opline++;
+
+		return;
+	}
+
+	// Waits fail fast once the deadline of the task context has been exceeded.
+	if (task->context->deadline != 0) {
+		if (concurrent_task_scheduler_now() >= task->context->deadline) {
+			concurrent_cancellation_create_exception(&error, "Deadline has been exceeded", NULL);
+
+			execute_data->opline--;
+			zend_throw_exception_internal(&error);
+			execute_data->opline++;
+
+			return;
+		}
+
+		concurrent_task_scheduler_watch_deadline(task);
+	}
+
+	GC_ADDREF(&task->fiber.std);
+
+	// Switch the value pointer to the return value of the suspending call until the task is continued.
+	value = task->fiber.value;
+	task->fiber.value = USED_RET() ? return_value : NULL;
+
+	task->fiber.status = CONCURRENT_FIBER_STATUS_SUSPENDED;
+
+	context = TASK_G(current_context);
+
+	CONCURRENT_FIBER_BACKUP_EG(task->fiber.stack, stack_page_size, task->fiber.exec);
+	concurrent_fiber_yield(task->fiber.context);
+	CONCURRENT_FIBER_RESTORE_EG(task->fiber.stack, stack_page_size, task->fiber.exec);
+
+	TASK_G(current_context) = context;
+
+	task->fiber.value = value;
+
+	if (task->deadline != NULL) {
+		concurrent_task_scheduler_unwatch_deadline(task);
+	}
+
+	// Cancelled tasks are unwound using the cancellation error.
+	if (task->fiber.status == CONCURRENT_FIBER_STATUS_DEAD && Z_TYPE_P(&task->error) == IS_UNDEF) {
+		zend_throw_error(NULL, "Task has been destroyed");
+		return;
+	}
+
+	if (Z_TYPE_P(&task->error) != IS_UNDEF) {
+		error = task->error;
+		ZVAL_UNDEF(&task->error);
+
+		execute_data->opline--;
+		zend_throw_exception_internal(&error);
+		execute_data->opline++;
+	}
+}
+
+void concurrent_task_continuation(void *obj, zval *result, zend_bool success)
 {
 	concurrent_task *task;
 
@@ -107,12 +197,209 @@ static void concurrent_task_continuation(void *obj, zval *result, zend_bool succ
 	OBJ_RELEASE(&task->fiber.std);
 }
 
+/*
+ * Cancels a task that has not been completed yet, returns 0 if the task is running or has already been completed.
+ * A suspended task is unwound immediately by throwing the error from its suspension point, the native stack of the
+ * task is released afterwards. Continuations of the task are failed using the given error.
+ */
+zend_bool concurrent_task_cancel(concurrent_task *task, zval *error)
+{
+	concurrent_context *context;
+	zend_bool woken;
+
+	if (task->fiber.status == CONCURRENT_FIBER_STATUS_INIT) {
+		zend_fcall_info_args_clear(&task->fiber.fci, 1);
+		zval_ptr_dtor(&task->fiber.fci.function_name);
+
+		// The task remains in the run queue, the scheduler skips tasks without pending operation.
+		task->operation = CONCURRENT_TASK_OPERATION_NONE;
+		task->fiber.status = CONCURRENT_FIBER_STATUS_DEAD;
+
+		woken = 1;
+	} else if (task->fiber.status == CONCURRENT_FIBER_STATUS_SUSPENDED) {
+		// A task that has already been continued has been enqueued and its suspension reference has been released.
+		woken = (task->operation == CONCURRENT_TASK_OPERATION_RESUME);
+
+		task->operation = CONCURRENT_TASK_OPERATION_NONE;
+		task->fiber.status = CONCURRENT_FIBER_STATUS_DEAD;
+
+		zval_ptr_dtor(&task->error);
+		ZVAL_COPY(&task->error, error);
+
+		// The unwound task restores its own context when it is resumed, the context of the caller must be restored.
+		context = TASK_G(current_context);
+
+		concurrent_fiber_switch_to(&task->fiber);
+
+		TASK_G(current_context) = context;
+
+		// The task might have caught the error and returned normally.
+		task->fiber.status = CONCURRENT_FIBER_STATUS_DEAD;
+
+		zval_ptr_dtor(&task->error);
+		ZVAL_UNDEF(&task->error);
+
+		concurrent_fiber_destroy(task->fiber.context);
+		task->fiber.context = NULL;
+	} else {
+		return 0;
+	}
+
+	zval_ptr_dtor(&task->result);
+	ZVAL_COPY(&task->result, error);
+
+	concurrent_awaitable_trigger_continuation(&task->continuation, &task->result, 0);
+
+	if (!woken) {
+		OBJ_RELEASE(&task->fiber.std);
+	}
+
+	return 1;
+}
+
+/* Returns the task that owns the active fiber, this includes tasks that are being unwound after cancellation. */
+concurrent_task *concurrent_task_get_active()
+{
+	concurrent_fiber *fiber;
+
+	fiber = TASK_G(current_fiber);
+
+	if (fiber == NULL || fiber->type != CONCURRENT_FIBER_TYPE_TASK) {
+		return NULL;
+	}
+
+	return (concurrent_task *) fiber;
+}
+
+concurrent_task *concurrent_task_get_current()
+{
+	concurrent_fiber *fiber;
+
+	fiber = TASK_G(current_fiber);
+
+	if (fiber == NULL || fiber->type != CONCURRENT_FIBER_TYPE_TASK || fiber->status != CONCURRENT_FIBER_STATUS_RUNNING) {
+		return NULL;
+	}
+
+	return (concurrent_task *) fiber;
+}
+
+/*
+ * Appends the waiter to the queue and suspends the running task until it is continued by a call to
+ * concurrent_task_continuation() with the waiting task. The waiter is removed from the queue when the task
+ * is resumed in any other way (like being destroyed).
+ */
+void concurrent_task_wait(concurrent_task_wait_queue *queue, concurrent_task_waiter *waiter, zval *return_value, zend_execute_data *execute_data)
+{
+	concurrent_task_wait_queue_push(queue, waiter);
+	concurrent_task_suspend(waiter->task, return_value, execute_data);
+
+	// The waiter may have been moved into another queue while the task was suspended.
+	if (waiter->queue != NULL) {
+		concurrent_task_wait_queue_remove(waiter);
+	}
+}
+
+void concurrent_task_wait_queue_push(concurrent_task_wait_queue *queue, concurrent_task_waiter *waiter)
+{
+	waiter->prev = queue->last;
+	waiter->next = NULL;
+	waiter->queue = queue;
+
+	if (queue->last == NULL) {
+		queue->first = waiter;
+	} else {
+		queue->last->next = waiter;
+	}
+
+	queue->last = waiter;
+}
+
+concurrent_task_waiter *concurrent_task_wait_queue_shift(concurrent_task_wait_queue *queue)
+{
+	concurrent_task_waiter *waiter;
+
+	waiter = queue->first;
+
+	if (waiter != NULL) {
+		concurrent_task_wait_queue_remove(waiter);
+	}
+
+	return waiter;
+}
+
+void concurrent_task_wait_queue_remove(concurrent_task_waiter *waiter)
+{
+	concurrent_task_wait_queue *queue;
+
+	queue = waiter->queue;
+
+	ZEND_ASSERT(queue != NULL);
+
+	if (waiter->prev == NULL) {
+		queue->first = waiter->next;
+	} else {
+		waiter->prev->next = waiter->next;
+	}
+
+	if (waiter->next == NULL) {
+		queue->last = waiter->prev;
+	} else {
+		waiter->next->prev = waiter->prev;
+	}
+
+	waiter->prev = NULL;
+	waiter->next = NULL;
+	waiter->queue = NULL;
+}
+
+/* Continues the task of a waiter that has been removed from its queue. */
+void concurrent_task_waiter_continue(concurrent_task_waiter *waiter, zval *result, zend_bool success)
+{
+	if (waiter->func != NULL) {
+		waiter->func(waiter, result, success);
+	} else {
+		concurrent_task_continuation(waiter->task, result, success);
+	}
+}
+
+/* Continues all waiting tasks with an error using the given message. */
+void concurrent_task_wait_queue_fail(concurrent_task_wait_queue *queue, const char *message)
+{
+	concurrent_task_waiter *waiter;
+
+	zval error;
+
+	if (queue->first == NULL) {
+		return;
+	}
+
+	object_init_ex(&error, zend_ce_error);
+	zend_update_property_string(zend_ce_error, &error, "message", sizeof("message")-1, message);
+
+	while ((waiter = concurrent_task_wait_queue_shift(queue)) != NULL) {
+		concurrent_task_waiter_continue(waiter, &error, 0);
+	}
+
+	zval_ptr_dtor(&error);
+}
+
 static void concurrent_task_execute_inline(concurrent_task *task, concurrent_task *inner)
 {
 	concurrent_context *context;
 	zend_bool success;
 
+	if (inner->context->token != NULL) {
+		concurrent_cancellation_token_attach(inner->context->token, inner);
+
+		if (inner->fiber.status == CONCURRENT_FIBER_STATUS_DEAD) {
+			return;
+		}
+	}
+
+	// The inlined task must not be cancelled while it is running on the call stack of the awaiting task.
 	inner->operation = CONCURRENT_TASK_OPERATION_NONE;
+	inner->fiber.status = CONCURRENT_FIBER_STATUS_RUNNING;
 
 	context = TASK_G(current_context);
 	TASK_G(current_context) = inner->context;
@@ -131,6 +418,8 @@ static void concurrent_task_execute_inline(concurrent_task *task, concurrent_tas
 
 		ZVAL_OBJ(&inner->result, EG(exception));
 		EG(exception) = NULL;
+
+		success = 0;
 	} else {
 		inner->fiber.status = CONCURRENT_FIBER_STATUS_FINISHED;
 
@@ -177,13 +466,22 @@ concurrent_task *concurrent_task_object_create()
 static void concurrent_task_object_destroy(zend_object *object)
 {
 	concurrent_task *task;
+	concurrent_context *context;
 
 	task = (concurrent_task *) object;
 
 	if (task->fiber.status == CONCURRENT_FIBER_STATUS_SUSPENDED) {
 		task->fiber.status = CONCURRENT_FIBER_STATUS_DEAD;
 
+		context = TASK_G(current_context);
+
 		concurrent_fiber_switch_to(&task->fiber);
+
+		TASK_G(current_context) = context;
+	}
+
+	if (task->deadline != NULL) {
+		concurrent_task_scheduler_unwatch_deadline(task);
 	}
 
 	if (task->fiber.status == CONCURRENT_FIBER_STATUS_INIT) {
@@ -192,10 +490,18 @@ static void concurrent_task_object_destroy(zend_object *object)
 		zval_ptr_dtor(&task->fiber.fci.function_name);
 	}
 
-	if (task->continuation != NULL) {
+	if (task->continuation.first != NULL) {
 		concurrent_awaitable_dispose_continuation(&task->continuation);
 	}
 
+	if (task->locals != NULL) {
+		concurrent_task_locals_destroy(task);
+	}
+
+	if (task->context->token != NULL) {
+		concurrent_cancellation_token_detach(task->context->token, task);
+	}
+
 	zval_ptr_dtor(&task->result);
 	zval_ptr_dtor(&task->error);
 
@@ -313,13 +619,10 @@ ZEND_METHOD(Task, await)
 	concurrent_fiber *fiber;
 	concurrent_task *task;
 	concurrent_task *inner;
-	concurrent_deferred *defer;
-	concurrent_context *context;
-	size_t stack_page_size;
 
 	zval *val;
-	zval *value;
-	zval error;
+	zval *result;
+	zend_bool success;
 
 	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
 		Z_PARAM_ZVAL(val)
@@ -384,11 +687,7 @@ ZEND_METHOD(Task, await)
 
 	ce = Z_OBJCE_P(val);
 
-	// Immediately return non-awaitable objects.
-	if (instanceof_function_ex(ce, concurrent_awaitable_ce, 1) != 1) {
-		RETURN_ZVAL(val, 1, 0);
-	}
-
+	// Only tasks and deferred awaitables implement Awaitable, other objects are returned unless they are thenables.
 	if (ce == concurrent_task_ce) {
 		inner = (concurrent_task *) Z_OBJ_P(val);
 
@@ -402,84 +701,584 @@ ZEND_METHOD(Task, await)
 				concurrent_task_execute_inline(task, inner);
 			}
 		}
+	} else if (ce != concurrent_deferred_awaitable_ce) {
+		if (concurrent_thenable_is_thenable(ce)) {
+			concurrent_thenable_await(task, val, return_value, execute_data);
+			return;
+		}
 
-		if (inner->fiber.status == CONCURRENT_FIBER_STATUS_FINISHED) {
-			RETURN_ZVAL(&inner->result, 1, 0);
+		RETURN_ZVAL(val, 1, 0);
+	}
+
+	if (!concurrent_awaitable_register(Z_OBJ_P(val), task, concurrent_task_continuation, &result, &success)) {
+		if (success) {
+			RETURN_ZVAL(result, 1, 0);
 		}
 
-		if (inner->fiber.status == CONCURRENT_FIBER_STATUS_DEAD) {
-			Z_ADDREF_P(&inner->result);
+		Z_ADDREF_P(result);
 
-			execute_data->opline--;
-			zend_throw_exception_internal(&inner->result);
-			execute_data->opline++;
+		execute_data->opline--;
+		zend_throw_exception_internal(result);
+		execute_data->opline++;
+
+		return;
+	}
+
+	concurrent_task_suspend(task, return_value, execute_data);
+
+	// Remove the continuation if the task has been unwound or cancelled before the awaitable was resolved.
+	if (UNEXPECTED(EG(exception))) {
+		concurrent_awaitable_unregister(Z_OBJ_P(val), task, concurrent_task_continuation);
+	}
+}
+
+typedef struct _concurrent_task_combinator concurrent_task_combinator;
 
+typedef struct _concurrent_task_combinator_entry {
+	concurrent_task_combinator *combinator;
+	zval *slot;
+} concurrent_task_combinator_entry;
+
+/*
+ * Shared state of a combinator call, one continuation is registered per input awaitable. The state is reference
+ * counted because continuations of inputs that did not decide the outcome are triggered after the caller has resumed.
+ */
+struct _concurrent_task_combinator {
+	/* Suspended task that waits for the outcome, NULL before suspension and after it has been continued. */
+	concurrent_task *task;
+
+	zend_uchar type;
+	zend_bool done;
+	zend_bool success;
+
+	uint32_t refcount;
+	uint32_t pending;
+
+	/* Result array of awaitAll() until the outcome is known, the outcome afterwards. */
+	zval result;
+
+	/* Last error seen by awaitFirstSuccessful(). */
+	zval error;
+
+	concurrent_task_combinator_entry entries[1];
+};
+
+static void concurrent_task_combinator_release(concurrent_task_combinator *combinator)
+{
+	if (--combinator->refcount > 0) {
+		return;
+	}
+
+	zval_ptr_dtor(&combinator->result);
+	zval_ptr_dtor(&combinator->error);
+
+	efree(combinator);
+}
+
+static void concurrent_task_combinator_resolve(concurrent_task_combinator *combinator, zval *slot, zval *result, zend_bool success)
+{
+	concurrent_task *task;
+
+	if (combinator->done) {
+		return;
+	}
+
+	combinator->pending--;
+
+	if (combinator->type == CONCURRENT_TASK_COMBINATOR_ALL) {
+		if (success) {
+			ZVAL_COPY(slot, result);
+
+			if (combinator->pending > 0) {
+				return;
+			}
+		} else {
+			zval_ptr_dtor(&combinator->result);
+			ZVAL_COPY(&combinator->result, result);
+		}
+	} else if (combinator->type == CONCURRENT_TASK_COMBINATOR_ANY || success) {
+		ZVAL_COPY(&combinator->result, result);
+	} else {
+		zval_ptr_dtor(&combinator->error);
+		ZVAL_COPY(&combinator->error, result);
+
+		if (combinator->pending > 0) {
 			return;
 		}
 
-		if (inner->continuation == NULL) {
-			inner->continuation = concurrent_awaitable_create_continuation(task, concurrent_task_continuation);
+		ZVAL_COPY_VALUE(&combinator->result, &combinator->error);
+		ZVAL_UNDEF(&combinator->error);
+	}
+
+	combinator->done = 1;
+	combinator->success = success;
+
+	if (combinator->task != NULL) {
+		task = combinator->task;
+		combinator->task = NULL;
+
+		concurrent_task_continuation(task, &combinator->result, success);
+	}
+}
+
+static void concurrent_task_combinator_continuation(void *obj, zval *result, zend_bool success)
+{
+	concurrent_task_combinator_entry *entry;
+	concurrent_task_combinator *combinator;
+
+	entry = (concurrent_task_combinator_entry *) obj;
+	combinator = entry->combinator;
+
+	concurrent_task_combinator_resolve(combinator, entry->slot, result, success);
+	concurrent_task_combinator_release(combinator);
+}
+
+static void concurrent_task_combine(INTERNAL_FUNCTION_PARAMETERS, zend_uchar type)
+{
+	concurrent_task_combinator *combinator;
+	concurrent_task_combinator_entry *entry;
+	concurrent_task *task;
+	concurrent_task *inner;
+
+	HashTable *table;
+	zend_string *key;
+	zend_ulong index;
+	uint32_t count;
+
+	zval *val;
+	zval *result;
+	zval tmp;
+	zend_bool success;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_ARRAY_HT(table)
+	ZEND_PARSE_PARAMETERS_END();
+
+	task = concurrent_task_get_current();
+
+	if (task == NULL) {
+		zend_throw_error(NULL, "Await must be called from within a running task");
+		return;
+	}
+
+	count = zend_hash_num_elements(table);
+
+	if (count == 0) {
+		if (type == CONCURRENT_TASK_COMBINATOR_ALL) {
+			array_init(return_value);
 		} else {
-			concurrent_awaitable_append_continuation(inner->continuation, task, concurrent_task_continuation);
+			zend_throw_error(NULL, "Cannot await an empty array of awaitables");
+		}
+
+		return;
+	}
+
+	ZEND_HASH_FOREACH_VAL(table, val) {
+		ZVAL_DEREF(val);
+
+		if (Z_TYPE_P(val) == IS_OBJECT && Z_OBJCE_P(val) == concurrent_task_ce) {
+			inner = (concurrent_task *) Z_OBJ_P(val);
+
+			if (inner->scheduler != task->scheduler) {
+				zend_throw_error(NULL, "Cannot await a task that runs on a different task scheduler");
+				return;
+			}
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	combinator = emalloc(sizeof(concurrent_task_combinator) + (count - 1) * sizeof(concurrent_task_combinator_entry));
+
+	combinator->task = NULL;
+	combinator->type = type;
+	combinator->done = 0;
+	combinator->success = 0;
+	combinator->refcount = 1;
+	combinator->pending = count;
+
+	ZVAL_UNDEF(&combinator->result);
+	ZVAL_UNDEF(&combinator->error);
+
+	// Slots of the result array are created up-front (in input order) so that they are never moved by a resize.
+	if (type == CONCURRENT_TASK_COMBINATOR_ALL) {
+		array_init_size(&combinator->result, count);
+
+		ZVAL_NULL(&tmp);
+
+		ZEND_HASH_FOREACH_KEY(table, index, key) {
+			if (key == NULL) {
+				zend_hash_index_update(Z_ARRVAL(combinator->result), index, &tmp);
+			} else {
+				zend_hash_update(Z_ARRVAL(combinator->result), key, &tmp);
+			}
+		} ZEND_HASH_FOREACH_END();
+	}
+
+	entry = combinator->entries;
+
+	ZEND_HASH_FOREACH_KEY_VAL(table, index, key, val) {
+		if (combinator->done) {
+			break;
 		}
-	} else if (ce == concurrent_deferred_awaitable_ce) {
-		defer = ((concurrent_deferred_awaitable *) Z_OBJ_P(val))->defer;
 
-		if (defer->status == CONCURRENT_DEFERRED_STATUS_RESOLVED) {
-			RETURN_ZVAL(&defer->result, 1, 0);
+		entry->combinator = combinator;
+		entry->slot = NULL;
+
+		if (type == CONCURRENT_TASK_COMBINATOR_ALL) {
+			if (key == NULL) {
+				entry->slot = zend_hash_index_find(Z_ARRVAL(combinator->result), index);
+			} else {
+				entry->slot = zend_hash_find(Z_ARRVAL(combinator->result), key);
+			}
 		}
 
-		if (defer->status == CONCURRENT_DEFERRED_STATUS_FAILED) {
-			Z_ADDREF_P(&defer->result);
+		ZVAL_DEREF(val);
+
+		if (Z_TYPE_P(val) == IS_OBJECT && instanceof_function_ex(Z_OBJCE_P(val), concurrent_awaitable_ce, 1)) {
+			if (concurrent_awaitable_register(Z_OBJ_P(val), entry, concurrent_task_combinator_continuation, &result, &success)) {
+				combinator->refcount++;
+			} else {
+				concurrent_task_combinator_resolve(combinator, entry->slot, result, success);
+			}
+		} else {
+			concurrent_task_combinator_resolve(combinator, entry->slot, val, 1);
+		}
+
+		entry++;
+	} ZEND_HASH_FOREACH_END();
+
+	if (combinator->done) {
+		if (combinator->success) {
+			RETVAL_ZVAL(&combinator->result, 1, 0);
+		} else {
+			Z_ADDREF(combinator->result);
 
 			execute_data->opline--;
-			zend_throw_exception_internal(&defer->result);
+			zend_throw_exception_internal(&combinator->result);
 			execute_data->opline++;
+		}
+	} else {
+		combinator->task = task;
 
-			return;
+		concurrent_task_suspend(task, return_value, execute_data);
+
+		combinator->task = NULL;
+	}
+
+	concurrent_task_combinator_release(combinator);
+}
+
+ZEND_METHOD(Task, awaitAll)
+{
+	concurrent_task_combine(INTERNAL_FUNCTION_PARAM_PASSTHRU, CONCURRENT_TASK_COMBINATOR_ALL);
+}
+
+ZEND_METHOD(Task, awaitAny)
+{
+	concurrent_task_combine(INTERNAL_FUNCTION_PARAM_PASSTHRU, CONCURRENT_TASK_COMBINATOR_ANY);
+}
+
+ZEND_METHOD(Task, awaitFirstSuccessful)
+{
+	concurrent_task_combine(INTERNAL_FUNCTION_PARAM_PASSTHRU, CONCURRENT_TASK_COMBINATOR_FIRST_SUCCESSFUL);
+}
+
+typedef struct _concurrent_task_select concurrent_task_select;
+
+typedef struct _concurrent_task_select_entry {
+	/* Waiter used to receive from a channel, must be the first member (the waiter callback receives the waiter). */
+	concurrent_task_waiter waiter;
+
+	concurrent_task_select *select;
+
+	/* Awaitable that the entry continuation has been registered with, NULL if no continuation is registered. */
+	zend_object *awaitable;
+
+	zend_string *key;
+	zend_ulong index;
+} concurrent_task_select_entry;
+
+struct _concurrent_task_select {
+	/* Suspended task that waits for the first candidate, NULL before suspension and after it has been continued. */
+	concurrent_task *task;
+
+	concurrent_task_select_entry *winner;
+
+	zend_bool success;
+
+	/* Outcome of the winning candidate. */
+	zval result;
+
+	uint32_t count;
+
+	concurrent_task_select_entry entries[1];
+};
+
+static void concurrent_task_select_resolve(concurrent_task_select_entry *entry, zval *result, zend_bool success)
+{
+	concurrent_task_select *select;
+	concurrent_task *task;
+	uint32_t i;
+
+	zval retval;
+
+	select = entry->select;
+
+	if (select->winner != NULL) {
+		return;
+	}
+
+	select->winner = entry;
+	select->success = success;
+
+	ZVAL_COPY(&select->result, result);
+
+	// Losing channel waiters are removed right away, a sender must not hand a value to a task that is not waiting.
+	for (i = 0; i < select->count; i++) {
+		if (select->entries[i].waiter.queue != NULL) {
+			concurrent_task_wait_queue_remove(&select->entries[i].waiter);
+		}
+	}
+
+	if (select->task != NULL) {
+		task = select->task;
+		select->task = NULL;
+
+		ZVAL_NULL(&retval);
+		concurrent_task_continuation(task, &retval, 1);
+	}
+}
+
+static void concurrent_task_select_continuation(void *obj, zval *result, zend_bool success)
+{
+	concurrent_task_select_entry *entry;
+
+	entry = (concurrent_task_select_entry *) obj;
+	entry->awaitable = NULL;
+
+	concurrent_task_select_resolve(entry, result, success);
+}
+
+ZEND_METHOD(Task, select)
+{
+	concurrent_task_select *select;
+	concurrent_task_select_entry *entry;
+	concurrent_channel *channel;
+	concurrent_task *task;
+
+	HashTable *table;
+	zend_string *key;
+	zend_ulong index;
+	uint32_t count;
+	uint32_t i;
+
+	zval *val;
+	zval *result;
+	zval tmp;
+	zend_bool success;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_ARRAY_HT(table)
+	ZEND_PARSE_PARAMETERS_END();
+
+	task = concurrent_task_get_current();
+
+	if (task == NULL) {
+		zend_throw_error(NULL, "Await must be called from within a running task");
+		return;
+	}
+
+	count = zend_hash_num_elements(table);
+
+	if (count == 0) {
+		zend_throw_error(NULL, "Cannot select from an empty array of awaitables");
+		return;
+	}
+
+	// A single allocation holds all candidates, it is released before the call returns.
+	select = emalloc(sizeof(concurrent_task_select) + (count - 1) * sizeof(concurrent_task_select_entry));
+	ZEND_SECURE_ZERO(select, sizeof(concurrent_task_select) + (count - 1) * sizeof(concurrent_task_select_entry));
+
+	ZVAL_UNDEF(&select->result);
+
+	entry = select->entries;
+
+	ZEND_HASH_FOREACH_KEY_VAL(table, index, key, val) {
+		if (select->winner != NULL) {
+			break;
 		}
 
-		if (defer->continuation == NULL) {
-			defer->continuation = concurrent_awaitable_create_continuation(task, concurrent_task_continuation);
+		entry->select = select;
+		entry->key = key;
+		entry->index = index;
+
+		select->count++;
+
+		ZVAL_DEREF(val);
+
+		if (Z_TYPE_P(val) == IS_OBJECT && Z_OBJCE_P(val) == concurrent_channel_ce) {
+			channel = (concurrent_channel *) Z_OBJ_P(val);
+
+			if (concurrent_channel_try_receive(channel, &tmp)) {
+				concurrent_task_select_resolve(entry, &tmp, 1);
+				zval_ptr_dtor(&tmp);
+			} else if (channel->closed) {
+				object_init_ex(&tmp, zend_ce_error);
+				zend_update_property_string(zend_ce_error, &tmp, "message", sizeof("message")-1, "Cannot receive a value from a closed channel");
+
+				concurrent_task_select_resolve(entry, &tmp, 0);
+				zval_ptr_dtor(&tmp);
+			} else {
+				entry->waiter.task = task;
+				entry->waiter.func = concurrent_task_select_continuation;
+
+				concurrent_task_wait_queue_push(&channel->receivers, &entry->waiter);
+			}
+		} else if (Z_TYPE_P(val) == IS_OBJECT && instanceof_function_ex(Z_OBJCE_P(val), concurrent_awaitable_ce, 1)) {
+			if (concurrent_awaitable_register(Z_OBJ_P(val), entry, concurrent_task_select_continuation, &result, &success)) {
+				entry->awaitable = Z_OBJ_P(val);
+			} else {
+				concurrent_task_select_resolve(entry, result, success);
+			}
 		} else {
-			concurrent_awaitable_append_continuation(defer->continuation, task, concurrent_task_continuation);
+			concurrent_task_select_resolve(entry, val, 1);
 		}
-	} else {
-		RETURN_ZVAL(val, 1, 0);
+
+		entry++;
+	} ZEND_HASH_FOREACH_END();
+
+	if (select->winner == NULL) {
+		select->task = task;
+
+		concurrent_task_suspend(task, NULL, execute_data);
+
+		select->task = NULL;
 	}
 
-	GC_ADDREF(&task->fiber.std);
+	// Unregister the continuations of all losing candidates, no callback may refer to the select afterwards.
+	for (i = 0; i < select->count; i++) {
+		entry = &select->entries[i];
 
-	// Switch the value pointer to the return value of await() until the task is continued.
-	value = task->fiber.value;
-	task->fiber.value = USED_RET() ? return_value : NULL;
+		if (entry->waiter.queue != NULL) {
+			concurrent_task_wait_queue_remove(&entry->waiter);
+		}
 
-	task->fiber.status = CONCURRENT_FIBER_STATUS_SUSPENDED;
+		if (entry->awaitable != NULL) {
+			concurrent_awaitable_unregister(entry->awaitable, entry, concurrent_task_select_continuation);
+		}
+	}
 
-	context = TASK_G(current_context);
+	if (select->winner != NULL && !EG(exception)) {
+		if (select->success) {
+			array_init_size(return_value, 2);
 
-	CONCURRENT_FIBER_BACKUP_EG(task->fiber.stack, stack_page_size, task->fiber.exec);
-	concurrent_fiber_yield(task->fiber.context);
-	CONCURRENT_FIBER_RESTORE_EG(task->fiber.stack, stack_page_size, task->fiber.exec);
+			if (select->winner->key == NULL) {
+				add_next_index_long(return_value, (zend_long) select->winner->index);
+			} else {
+				add_next_index_str(return_value, zend_string_copy(select->winner->key));
+			}
 
-	TASK_G(current_context) = context;
+			Z_TRY_ADDREF_P(&select->result);
+			add_next_index_zval(return_value, &select->result);
+		} else {
+			Z_ADDREF_P(&select->result);
 
-	task->fiber.value = value;
+			execute_data->opline--;
+			zend_throw_exception_internal(&select->result);
+			execute_data->opline++;
+		}
+	}
 
-	if (task->fiber.status == CONCURRENT_FIBER_STATUS_DEAD) {
-		zend_throw_error(NULL, "Task has been destroyed");
+	zval_ptr_dtor(&select->result);
+	efree(select);
+}
+
+ZEND_METHOD(Task, awaitSignal)
+{
+	concurrent_fiber *fiber;
+	concurrent_task *task;
+	zend_long signo;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_LONG(signo)
+	ZEND_PARSE_PARAMETERS_END();
+
+	fiber = TASK_G(current_fiber);
+
+	if (fiber == NULL || fiber->type != CONCURRENT_FIBER_TYPE_TASK) {
+		zend_throw_error(NULL, "Await must be called from within a running task");
 		return;
 	}
 
-	if (Z_TYPE_P(&task->error) != IS_UNDEF) {
-		error = task->error;
-		ZVAL_UNDEF(&task->error);
+	if (UNEXPECTED(fiber->status != CONCURRENT_FIBER_STATUS_RUNNING)) {
+		zend_throw_error(NULL, "Cannot await in a task that is not running");
+		return;
+	}
+
+	task = (concurrent_task *) fiber;
+
+	if (!concurrent_signal_watcher_register(task, signo)) {
+		return;
+	}
+
+	concurrent_task_suspend(task, return_value, execute_data);
+
+	if (UNEXPECTED(EG(exception))) {
+		concurrent_signal_watcher_unregister(task, signo);
+	}
+}
+
+/* {{{ proto void Task::registerThenable(string $class) */
+ZEND_METHOD(Task, registerThenable)
+{
+	zend_class_entry *ce;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_CLASS(ce)
+	ZEND_PARSE_PARAMETERS_END();
+
+	concurrent_thenable_register(ce);
+}
+/* }}} */
+
+/* {{{ proto void Task::cancel(?Throwable $reason = null) */
+ZEND_METHOD(Task, cancel)
+{
+	concurrent_task *task;
+
+	zval *reason;
+	zval error;
+
+	reason = NULL;
 
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_OBJECT_OF_CLASS_EX(reason, zend_ce_throwable, 1, 0)
+	ZEND_PARSE_PARAMETERS_END();
+
+	task = (concurrent_task *) Z_OBJ_P(getThis());
+
+	if (task->fiber.status == CONCURRENT_FIBER_STATUS_FINISHED || task->fiber.status == CONCURRENT_FIBER_STATUS_DEAD) {
+		return;
+	}
+
+	concurrent_cancellation_create_exception(&error, "Task has been cancelled", reason);
+
+	// A task cannot unwind its own call stack, the exception is thrown into the task instead.
+	if (task == concurrent_task_get_current()) {
 		execute_data->opline--;
 		zend_throw_exception_internal(&error);
 		execute_data->opline++;
+
+		return;
+	}
+
+	if (!concurrent_task_cancel(task, &error)) {
+		zend_throw_error(NULL, "Cannot cancel a task that is running");
 	}
+
+	zval_ptr_dtor(&error);
 }
+/* }}} */
 
 ZEND_METHOD(Task, __wakeup)
 {
@@ -509,6 +1308,38 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_task_await, 0, 0, 1)
 	ZEND_ARG_INFO(0, value)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_await_all, 0, 0, 1)
+	ZEND_ARG_ARRAY_INFO(0, awaitables, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_await_any, 0, 0, 1)
+	ZEND_ARG_ARRAY_INFO(0, awaitables, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_await_first_successful, 0, 0, 1)
+	ZEND_ARG_ARRAY_INFO(0, awaitables, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_task_select, 0, 1, IS_ARRAY, 0)
+	ZEND_ARG_ARRAY_INFO(0, awaitables, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_await_signal, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, signal, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_register_thenable, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, class, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_cancel, 0, 0, 0)
+	ZEND_ARG_OBJ_INFO(0, reason, Throwable, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_task_transform, 0, 1, Concurrent\\Awaitable, 0)
+	ZEND_ARG_CALLABLE_INFO(0, callback, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO(arginfo_task_wakeup, 0)
 ZEND_END_ARG_INFO()
 
@@ -518,6 +1349,16 @@ static const zend_function_entry task_functions[] = {
 	ZEND_ME(Task, async, arginfo_task_async, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
 	ZEND_ME(Task, asyncWithContext, arginfo_task_async_with_context, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
 	ZEND_ME(Task, await, arginfo_task_await, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+	ZEND_ME(Task, awaitAll, arginfo_task_await_all, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+	ZEND_ME(Task, awaitAny, arginfo_task_await_any, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+	ZEND_ME(Task, awaitFirstSuccessful, arginfo_task_await_first_successful, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+	ZEND_ME(Task, select, arginfo_task_select, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+	ZEND_ME(Task, awaitSignal, arginfo_task_await_signal, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+	ZEND_ME(Task, registerThenable, arginfo_task_register_thenable, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+	ZEND_ME(Task, cancel, arginfo_task_cancel, ZEND_ACC_PUBLIC)
+	ZEND_ME(Awaitable, map, arginfo_task_transform, ZEND_ACC_PUBLIC)
+	ZEND_ME(Awaitable, catch, arginfo_task_transform, ZEND_ACC_PUBLIC)
+	ZEND_ME(Awaitable, finally, arginfo_task_transform, ZEND_ACC_PUBLIC)
 	ZEND_ME(Task, __wakeup, arginfo_task_wakeup, ZEND_ACC_PUBLIC)
 	ZEND_FE_END
 };
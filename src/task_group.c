@@ -0,0 +1,312 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+zend_class_entry *concurrent_task_group_ce;
+
+static zend_object_handlers concurrent_task_group_handlers;
+
+
+/* Cancels all pending children, the error is recorded as group error unless a child has already failed. */
+static void concurrent_task_group_cancel(concurrent_task_group *group, const char *message)
+{
+	concurrent_task *task;
+	uint32_t i;
+
+	zval error;
+	zval *entry;
+
+	concurrent_cancellation_create_exception(&error, message, NULL);
+
+	if (Z_TYPE_P(&group->error) == IS_UNDEF) {
+		ZVAL_COPY(&group->error, &error);
+	}
+
+	// Children may be spawned while cancelled tasks are unwound, iterate by index to pick them up safely.
+	for (i = 0; i < zend_hash_num_elements(&group->children); i++) {
+		entry = zend_hash_index_find(&group->children, i);
+		task = (concurrent_task *) Z_OBJ_P(entry);
+
+		concurrent_task_cancel(task, &error);
+	}
+
+	zval_ptr_dtor(&error);
+}
+
+static void concurrent_task_group_continuation(void *obj, zval *result, zend_bool success)
+{
+	concurrent_task_group *group;
+	concurrent_task_waiter *waiter;
+
+	zval retval;
+
+	group = (concurrent_task_group *) obj;
+
+	group->pending--;
+
+	if (!success && Z_TYPE_P(&group->error) == IS_UNDEF) {
+		ZVAL_COPY(&group->error, result);
+
+		concurrent_task_group_cancel(group, "Task has been cancelled because another task of the group failed");
+	}
+
+	if (group->pending > 0 && success) {
+		return;
+	}
+
+	ZVAL_NULL(&retval);
+
+	while ((waiter = concurrent_task_wait_queue_shift(&group->waiters)) != NULL) {
+		concurrent_task_continuation(waiter->task, &retval, 1);
+	}
+}
+
+static zend_object *concurrent_task_group_object_create(zend_class_entry *ce)
+{
+	concurrent_task_group *group;
+
+	group = emalloc(sizeof(concurrent_task_group));
+	ZEND_SECURE_ZERO(group, sizeof(concurrent_task_group));
+
+	zend_object_std_init(&group->std, ce);
+	group->std.handlers = &concurrent_task_group_handlers;
+
+	zend_hash_init(&group->children, 8, NULL, ZVAL_PTR_DTOR, 0);
+
+	ZVAL_UNDEF(&group->error);
+
+	return &group->std;
+}
+
+static void concurrent_task_group_object_destroy(zend_object *object)
+{
+	concurrent_task_group *group;
+	concurrent_task *task;
+
+	zval *entry;
+
+	group = (concurrent_task_group *) object;
+
+	if (group->pending > 0) {
+		// Children must not call back into the group while they are cancelled.
+		ZEND_HASH_FOREACH_VAL(&group->children, entry) {
+			task = (concurrent_task *) Z_OBJ_P(entry);
+
+			concurrent_awaitable_remove_continuation(&task->continuation, group, concurrent_task_group_continuation);
+		} ZEND_HASH_FOREACH_END();
+
+		group->pending = 0;
+
+		concurrent_task_group_cancel(group, "Task group has been disposed");
+	}
+
+	concurrent_task_wait_queue_fail(&group->waiters, "Task group has been disposed");
+
+	zend_hash_destroy(&group->children);
+	zval_ptr_dtor(&group->error);
+
+	zend_object_std_dtor(&group->std);
+}
+
+ZEND_METHOD(TaskGroup, spawn)
+{
+	concurrent_task_group *group;
+	concurrent_task *task;
+	zval *params;
+	zval obj;
+
+	group = (concurrent_task_group *) Z_OBJ_P(getThis());
+
+	task = concurrent_task_object_create();
+	task->scheduler = concurrent_task_scheduler_get();
+	task->context = concurrent_context_get();
+
+	ZEND_ASSERT(task->scheduler != NULL);
+
+	params = NULL;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 2)
+		Z_PARAM_FUNC_EX(task->fiber.fci, task->fiber.fcc, 1, 0)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_ARRAY(params)
+	ZEND_PARSE_PARAMETERS_END();
+
+	task->fiber.fci.no_separation = 1;
+
+	if (params == NULL) {
+		task->fiber.fci.param_count = 0;
+	} else {
+		zend_fcall_info_args(&task->fiber.fci, params);
+	}
+
+	Z_TRY_ADDREF_P(&task->fiber.fci.function_name);
+
+	GC_ADDREF(&task->context->std);
+
+	ZVAL_OBJ(&obj, &task->fiber.std);
+
+	// The group keeps the reference of the created task.
+	zend_hash_next_index_insert(&group->children, &obj);
+
+	concurrent_task_scheduler_enqueue(task);
+
+	if (Z_TYPE_P(&group->error) != IS_UNDEF) {
+		concurrent_task_cancel(task, &group->error);
+	} else {
+		concurrent_awaitable_append_continuation(&task->continuation, group, concurrent_task_group_continuation);
+		group->pending++;
+	}
+
+	RETURN_ZVAL(&obj, 1, 0);
+}
+
+ZEND_METHOD(TaskGroup, awaitAll)
+{
+	concurrent_task_group *group;
+	concurrent_task_waiter waiter;
+	concurrent_task *task;
+
+	zval *entry;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	group = (concurrent_task_group *) Z_OBJ_P(getThis());
+
+	while (group->pending > 0 && Z_TYPE_P(&group->error) == IS_UNDEF) {
+		ZEND_SECURE_ZERO(&waiter, sizeof(concurrent_task_waiter));
+
+		waiter.task = concurrent_task_get_current();
+
+		if (waiter.task == NULL) {
+			zend_throw_error(NULL, "Cannot await a task group outside of a running task");
+			return;
+		}
+
+		concurrent_task_wait(&group->waiters, &waiter, NULL, execute_data);
+
+		if (UNEXPECTED(EG(exception))) {
+			return;
+		}
+	}
+
+	if (Z_TYPE_P(&group->error) != IS_UNDEF) {
+		Z_ADDREF_P(&group->error);
+
+		execute_data->opline--;
+		zend_throw_exception_internal(&group->error);
+		execute_data->opline++;
+
+		return;
+	}
+
+	array_init_size(return_value, zend_hash_num_elements(&group->children));
+
+	ZEND_HASH_FOREACH_VAL(&group->children, entry) {
+		task = (concurrent_task *) Z_OBJ_P(entry);
+
+		Z_TRY_ADDREF_P(&task->result);
+		zend_hash_next_index_insert(Z_ARRVAL_P(return_value), &task->result);
+	} ZEND_HASH_FOREACH_END();
+}
+
+ZEND_METHOD(TaskGroup, cancel)
+{
+	concurrent_task_group *group;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	group = (concurrent_task_group *) Z_OBJ_P(getThis());
+
+	if (group->pending > 0) {
+		concurrent_task_group_cancel(group, "Task group has been cancelled");
+	}
+}
+
+ZEND_METHOD(TaskGroup, count)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	RETURN_LONG(((concurrent_task_group *) Z_OBJ_P(getThis()))->pending);
+}
+
+ZEND_METHOD(TaskGroup, __wakeup)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Unserialization of a task group is not allowed");
+}
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_task_group_spawn, 0, 1, Concurrent\\Task, 0)
+	ZEND_ARG_CALLABLE_INFO(0, callback, 0)
+	ZEND_ARG_ARRAY_INFO(0, arguments, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_task_group_await_all, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_task_group_cancel, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_task_group_count, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_task_group_wakeup, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry task_group_functions[] = {
+	ZEND_ME(TaskGroup, spawn, arginfo_task_group_spawn, ZEND_ACC_PUBLIC)
+	ZEND_ME(TaskGroup, awaitAll, arginfo_task_group_await_all, ZEND_ACC_PUBLIC)
+	ZEND_ME(TaskGroup, cancel, arginfo_task_group_cancel, ZEND_ACC_PUBLIC)
+	ZEND_ME(TaskGroup, count, arginfo_task_group_count, ZEND_ACC_PUBLIC)
+	ZEND_ME(TaskGroup, __wakeup, arginfo_task_group_wakeup, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+void concurrent_task_group_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\TaskGroup", task_group_functions);
+	concurrent_task_group_ce = zend_register_internal_class(&ce);
+	concurrent_task_group_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_task_group_ce->create_object = concurrent_task_group_object_create;
+	concurrent_task_group_ce->serialize = zend_class_serialize_deny;
+	concurrent_task_group_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_task_group_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_task_group_handlers.free_obj = concurrent_task_group_object_destroy;
+	concurrent_task_group_handlers.clone_obj = NULL;
+
+	zend_class_implements(concurrent_task_group_ce, 1, zend_ce_countable);
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
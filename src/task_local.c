@@ -0,0 +1,225 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+ZEND_DECLARE_MODULE_GLOBALS(task)
+
+zend_class_entry *concurrent_task_local_ce;
+
+static zend_object_handlers concurrent_task_local_handlers;
+
+
+void concurrent_task_locals_destroy(concurrent_task *task)
+{
+	uint32_t i;
+
+	for (i = 0; i < task->local_count; i++) {
+		zval_ptr_dtor(&task->locals[i].value);
+	}
+
+	efree(task->locals);
+
+	task->locals = NULL;
+	task->local_count = 0;
+}
+
+/* Returns the slot holding the value of the local in the given task, NULL if the local has not been set in the task. */
+static zend_always_inline concurrent_task_local_slot *concurrent_task_local_find(concurrent_task *task, concurrent_task_local *local)
+{
+	concurrent_task_local_slot *slot;
+
+	if (local->slot >= task->local_count) {
+		return NULL;
+	}
+
+	slot = &task->locals[local->slot];
+
+	return (slot->version == local->version) ? slot : NULL;
+}
+
+static concurrent_task *concurrent_task_local_task()
+{
+	concurrent_task *task;
+
+	// Locals remain accessible while a cancelled task is unwound, cleanup code in finally blocks depends on them.
+	task = concurrent_task_get_active();
+
+	if (UNEXPECTED(task == NULL)) {
+		zend_throw_error(NULL, "Task locals can only be accessed from within a task");
+	}
+
+	return task;
+}
+
+
+static zend_object *concurrent_task_local_object_create(zend_class_entry *ce)
+{
+	concurrent_task_local *local;
+
+	local = emalloc(sizeof(concurrent_task_local));
+	ZEND_SECURE_ZERO(local, sizeof(concurrent_task_local));
+
+	zend_object_std_init(&local->std, ce);
+	local->std.handlers = &concurrent_task_local_handlers;
+
+	// Released slots are reused, the version tells values of the previous owner apart.
+	if (TASK_G(task_local_free_count) > 0) {
+		local->slot = TASK_G(task_local_free)[--TASK_G(task_local_free_count)];
+	} else {
+		local->slot = TASK_G(task_local_slots)++;
+	}
+
+	local->version = ++TASK_G(task_local_version);
+
+	return &local->std;
+}
+
+static void concurrent_task_local_object_destroy(zend_object *object)
+{
+	concurrent_task_local *local;
+
+	local = (concurrent_task_local *) object;
+
+	if (TASK_G(task_local_free_count) == TASK_G(task_local_free_size)) {
+		TASK_G(task_local_free_size) = MAX(16, TASK_G(task_local_free_size) * 2);
+		TASK_G(task_local_free) = erealloc(TASK_G(task_local_free), sizeof(uint32_t) * TASK_G(task_local_free_size));
+	}
+
+	TASK_G(task_local_free)[TASK_G(task_local_free_count)++] = local->slot;
+
+	zend_object_std_dtor(&local->std);
+}
+
+ZEND_METHOD(TaskLocal, get)
+{
+	concurrent_task_local_slot *slot;
+	concurrent_task *task;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	task = concurrent_task_local_task();
+
+	if (UNEXPECTED(task == NULL)) {
+		return;
+	}
+
+	slot = concurrent_task_local_find(task, (concurrent_task_local *) Z_OBJ_P(getThis()));
+
+	if (slot == NULL) {
+		return;
+	}
+
+	RETURN_ZVAL(&slot->value, 1, 0);
+}
+
+ZEND_METHOD(TaskLocal, set)
+{
+	concurrent_task_local *local;
+	concurrent_task_local_slot *slot;
+	concurrent_task *task;
+	uint32_t count;
+
+	zval *value;
+	zval tmp;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_ZVAL(value)
+	ZEND_PARSE_PARAMETERS_END();
+
+	task = concurrent_task_local_task();
+
+	if (UNEXPECTED(task == NULL)) {
+		return;
+	}
+
+	local = (concurrent_task_local *) Z_OBJ_P(getThis());
+
+	if (local->slot >= task->local_count) {
+		count = MAX(MAX(local->slot + 1, task->local_count * 2), 4);
+
+		task->locals = erealloc(task->locals, sizeof(concurrent_task_local_slot) * count);
+		memset(task->locals + task->local_count, 0, sizeof(concurrent_task_local_slot) * (count - task->local_count));
+
+		task->local_count = count;
+	}
+
+	slot = &task->locals[local->slot];
+
+	ZVAL_COPY_VALUE(&tmp, &slot->value);
+	ZVAL_COPY(&slot->value, value);
+
+	slot->version = local->version;
+
+	// The previous value is released last, its destructor may access the local again.
+	zval_ptr_dtor(&tmp);
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_local_get, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_task_local_set, 0, 1, IS_VOID, 0)
+	ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry task_local_functions[] = {
+	ZEND_ME(TaskLocal, get, arginfo_task_local_get, ZEND_ACC_PUBLIC)
+	ZEND_ME(TaskLocal, set, arginfo_task_local_set, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+void concurrent_task_local_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\TaskLocal", task_local_functions);
+	concurrent_task_local_ce = zend_register_internal_class(&ce);
+	concurrent_task_local_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_task_local_ce->create_object = concurrent_task_local_object_create;
+	concurrent_task_local_ce->serialize = zend_class_serialize_deny;
+	concurrent_task_local_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_task_local_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_task_local_handlers.free_obj = concurrent_task_local_object_destroy;
+	concurrent_task_local_handlers.clone_obj = NULL;
+}
+
+void concurrent_task_local_shutdown()
+{
+	if (TASK_G(task_local_free) != NULL) {
+		efree(TASK_G(task_local_free));
+	}
+
+	TASK_G(task_local_slots) = 0;
+	TASK_G(task_local_version) = 0;
+	TASK_G(task_local_free) = NULL;
+	TASK_G(task_local_free_count) = 0;
+	TASK_G(task_local_free_size) = 0;
+}
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
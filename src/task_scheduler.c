@@ -25,12 +25,25 @@
 
 #include "php_task.h"
 
+#include <time.h>
+
+#ifndef CLOCK_MONOTONIC
+# ifdef PHP_WIN32
+#  include "win32/time.h"
+# else
+#  include <sys/time.h>
+# endif
+#endif
+
 ZEND_DECLARE_MODULE_GLOBALS(task)
 
 zend_class_entry *concurrent_task_scheduler_ce;
 
 static zend_object_handlers concurrent_task_scheduler_handlers;
 
+/* Run time (in microseconds) a tenant with weight 1 receives per round. */
+#define CONCURRENT_TASK_SCHEDULER_QUANTUM 1000
+
 
 concurrent_task_scheduler *concurrent_task_scheduler_get()
 {
@@ -61,6 +74,200 @@ concurrent_task_scheduler *concurrent_task_scheduler_get()
 	return scheduler;
 }
 
+static void concurrent_task_scheduler_tenant_dtor(zval *zv)
+{
+	concurrent_task_scheduler_tenant *tenant;
+
+	tenant = (concurrent_task_scheduler_tenant *) Z_PTR_P(zv);
+
+	zend_string_release(tenant->name);
+
+	efree(tenant);
+}
+
+static concurrent_task_scheduler_tenant *concurrent_task_scheduler_get_tenant(concurrent_task_scheduler *scheduler, zend_string *name)
+{
+	concurrent_task_scheduler_tenant *tenant;
+
+	if (scheduler->tenants == NULL) {
+		ALLOC_HASHTABLE(scheduler->tenants);
+		zend_hash_init(scheduler->tenants, 8, NULL, concurrent_task_scheduler_tenant_dtor, 0);
+	}
+
+	tenant = zend_hash_find_ptr(scheduler->tenants, name);
+
+	if (tenant == NULL) {
+		tenant = ecalloc(1, sizeof(concurrent_task_scheduler_tenant));
+		tenant->name = zend_string_copy(name);
+		tenant->weight = 1;
+
+		zend_hash_add_new_ptr(scheduler->tenants, name, tenant);
+	}
+
+	return tenant;
+}
+
+/* Tenants are identified by string or integer values of the tenant key, tasks without a valid value share a tenant. */
+static concurrent_task_scheduler_tenant *concurrent_task_scheduler_resolve_tenant(concurrent_task_scheduler *scheduler, concurrent_task *task)
+{
+	concurrent_task_scheduler_tenant *tenant;
+	zend_string *name;
+
+	zval *val;
+
+	val = concurrent_context_lookup(task->context, &scheduler->tenant_key);
+
+	if (val != NULL && Z_TYPE_P(val) == IS_STRING) {
+		name = zend_string_copy(Z_STR_P(val));
+	} else if (val != NULL && Z_TYPE_P(val) == IS_LONG) {
+		name = zend_long_to_str(Z_LVAL_P(val));
+	} else {
+		name = ZSTR_EMPTY_ALLOC();
+	}
+
+	tenant = concurrent_task_scheduler_get_tenant(scheduler, name);
+
+	zend_string_release(name);
+
+	return tenant;
+}
+
+/*
+ * Drops a tenant that has no tasks scheduled and uses the default weight, per-request or per-customer tenant keys
+ * would grow the tenant table without bounds otherwise. Statistics of dropped tenants are discarded.
+ */
+static void concurrent_task_scheduler_release_tenant(concurrent_task_scheduler *scheduler, concurrent_task_scheduler_tenant *tenant)
+{
+	if (tenant->active || tenant->scheduled > 0 || tenant->weight != 1) {
+		return;
+	}
+
+	zend_hash_del(scheduler->tenants, tenant->name);
+}
+
+static void concurrent_task_scheduler_enqueue_tenant(concurrent_task_scheduler *scheduler, concurrent_task *task)
+{
+	concurrent_task_scheduler_tenant *tenant;
+
+	// Tenants are not cached across suspension, the tenant might have been dropped in the meantime.
+	tenant = concurrent_task_scheduler_resolve_tenant(scheduler, task);
+	task->tenant = tenant;
+
+	if (tenant->last == NULL) {
+		tenant->first = task;
+	} else {
+		tenant->last->next = task;
+	}
+
+	tenant->last = task;
+	tenant->scheduled++;
+
+	if (!tenant->active) {
+		tenant->active = 1;
+		tenant->next = NULL;
+
+		if (scheduler->active_last == NULL) {
+			scheduler->active_first = tenant;
+		} else {
+			scheduler->active_last->next = tenant;
+		}
+
+		scheduler->active_last = tenant;
+	}
+}
+
+/* Moves the first active tenant to the end of the round-robin list. */
+static void concurrent_task_scheduler_rotate(concurrent_task_scheduler *scheduler)
+{
+	concurrent_task_scheduler_tenant *tenant;
+
+	tenant = scheduler->active_first;
+
+	if (tenant->next == NULL) {
+		return;
+	}
+
+	scheduler->active_first = tenant->next;
+	scheduler->active_last->next = tenant;
+	scheduler->active_last = tenant;
+
+	tenant->next = NULL;
+}
+
+/*
+ * Removes the next task from the run queue. Tenants are served using deficit round-robin: the first active tenant
+ * runs tasks as long as it has run time left, each visit of a tenant adds weight times the quantum.
+ */
+static concurrent_task *concurrent_task_scheduler_dequeue(concurrent_task_scheduler *scheduler)
+{
+	concurrent_task_scheduler_tenant *tenant;
+	concurrent_task *task;
+
+	if (scheduler->active_first == NULL) {
+		task = scheduler->first;
+
+		if (task != NULL) {
+			scheduler->first = task->next;
+
+			if (scheduler->last == task) {
+				scheduler->last = NULL;
+			}
+		}
+
+		return task;
+	}
+
+	while (1) {
+		tenant = scheduler->active_first;
+
+		if (tenant->deficit > 0) {
+			break;
+		}
+
+		tenant->deficit += CONCURRENT_TASK_SCHEDULER_QUANTUM * tenant->weight;
+
+		if (tenant->deficit > 0 || tenant->next == NULL) {
+			break;
+		}
+
+		concurrent_task_scheduler_rotate(scheduler);
+	}
+
+	task = tenant->first;
+
+	tenant->first = task->next;
+	tenant->scheduled--;
+
+	// Tenants leave the round-robin list when they run out of tasks, unused run time is not carried over.
+	if (tenant->first == NULL) {
+		tenant->last = NULL;
+		tenant->active = 0;
+		tenant->deficit = MIN(tenant->deficit, 0);
+
+		scheduler->active_first = tenant->next;
+
+		if (scheduler->active_last == tenant) {
+			scheduler->active_last = NULL;
+		}
+
+		tenant->next = NULL;
+	}
+
+	return task;
+}
+
+/* Charges the run time of a task to its tenant, tenants that used up their run time yield to the next tenant. */
+static void concurrent_task_scheduler_charge(concurrent_task_scheduler *scheduler, concurrent_task_scheduler_tenant *tenant, zend_long run_time)
+{
+	tenant->runs++;
+	tenant->run_time += run_time;
+	tenant->deficit -= run_time;
+
+	if (tenant->deficit <= 0 && tenant->active && scheduler->active_first == tenant) {
+		concurrent_task_scheduler_rotate(scheduler);
+	}
+}
+
 zend_bool concurrent_task_scheduler_enqueue(concurrent_task *task)
 {
 	concurrent_task_scheduler *scheduler;
@@ -80,7 +287,9 @@ zend_bool concurrent_task_scheduler_enqueue(concurrent_task *task)
 		return 0;
 	}
 
-	if (scheduler->last == NULL) {
+	if (Z_TYPE(scheduler->tenant_key) != IS_UNDEF) {
+		concurrent_task_scheduler_enqueue_tenant(scheduler, task);
+	} else if (scheduler->last == NULL) {
 		scheduler->first = task;
 		scheduler->last = task;
 	} else {
@@ -132,24 +341,27 @@ void concurrent_task_scheduler_run_loop(concurrent_task_scheduler *scheduler)
 
 static void concurrent_task_scheduler_run(concurrent_task_scheduler *scheduler)
 {
+	concurrent_task_scheduler_tenant *tenant;
 	concurrent_task *task;
+	zend_long start;
 
 	scheduler->running = 1;
 	scheduler->activate = 0;
 
-	while (scheduler->first != NULL) {
-		task = scheduler->first;
-
+	while ((task = concurrent_task_scheduler_dequeue(scheduler)) != NULL) {
 		scheduler->scheduled--;
-		scheduler->first = task->next;
 
-		if (scheduler->last == task) {
-			scheduler->last = NULL;
-		}
+		tenant = task->tenant;
+		task->tenant = NULL;
 
 		// A task scheduled for start might have been inlined, do not take action in this case.
 		if (task->operation != CONCURRENT_TASK_OPERATION_NONE) {
 			task->next = NULL;
+			start = 0;
+
+			if (tenant != NULL) {
+				start = concurrent_task_scheduler_now();
+			}
 
 			if (task->operation == CONCURRENT_TASK_OPERATION_START) {
 				concurrent_task_start(task);
@@ -157,6 +369,10 @@ static void concurrent_task_scheduler_run(concurrent_task_scheduler *scheduler)
 				concurrent_task_continue(task);
 			}
 
+			if (tenant != NULL) {
+				concurrent_task_scheduler_charge(scheduler, tenant, concurrent_task_scheduler_now() - start);
+			}
+
 			if (UNEXPECTED(EG(exception))) {
 				ZVAL_OBJ(&task->result, EG(exception));
 				EG(exception) = NULL;
@@ -171,6 +387,10 @@ static void concurrent_task_scheduler_run(concurrent_task_scheduler *scheduler)
 			}
 		}
 
+		if (tenant != NULL) {
+			concurrent_task_scheduler_release_tenant(scheduler, tenant);
+		}
+
 		OBJ_RELEASE(&task->fiber.std);
 	}
 
@@ -180,6 +400,234 @@ static void concurrent_task_scheduler_run(concurrent_task_scheduler *scheduler)
 	scheduler->activate = 1;
 }
 
+/* Returns the current time in microseconds, the clock is monotonic if the platform provides a monotonic clock. */
+zend_long concurrent_task_scheduler_now()
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((zend_long) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return ((zend_long) tv.tv_sec * 1000000) + tv.tv_usec;
+#endif
+}
+
+/* Registers a task that is about to be suspended with the (shared) timer of the deadline of its context. */
+void concurrent_task_scheduler_watch_deadline(concurrent_task *task)
+{
+	concurrent_task_deadline *deadline;
+	concurrent_task_deadline **ref;
+	zend_long time;
+
+	ZEND_ASSERT(task->scheduler != NULL);
+
+	time = task->context->deadline;
+	ref = &task->scheduler->deadlines;
+
+	while (*ref != NULL && (*ref)->time < time) {
+		ref = &(*ref)->next;
+	}
+
+	deadline = *ref;
+
+	if (deadline == NULL || deadline->time != time) {
+		deadline = emalloc(sizeof(concurrent_task_deadline));
+		deadline->time = time;
+		deadline->next = *ref;
+
+		zend_hash_init(&deadline->tasks, 8, NULL, NULL, 0);
+
+		*ref = deadline;
+	}
+
+	zend_hash_index_add_ptr(&deadline->tasks, (zend_ulong) task->id, task);
+
+	task->deadline = deadline;
+}
+
+void concurrent_task_scheduler_unwatch_deadline(concurrent_task *task)
+{
+	concurrent_task_deadline *deadline;
+	concurrent_task_deadline **ref;
+
+	deadline = task->deadline;
+	task->deadline = NULL;
+
+	zend_hash_index_del(&deadline->tasks, (zend_ulong) task->id);
+
+	if (zend_hash_num_elements(&deadline->tasks) > 0) {
+		return;
+	}
+
+	for (ref = &task->scheduler->deadlines; *ref != deadline; ref = &(*ref)->next);
+
+	*ref = deadline->next;
+
+	zend_hash_destroy(&deadline->tasks);
+	efree(deadline);
+}
+
+/* Cancels all tasks of the scheduler waiting for an expired deadline, returns the number of cancelled tasks. */
+static int concurrent_task_scheduler_expire(concurrent_task_scheduler *scheduler)
+{
+	concurrent_task_deadline *deadline;
+	concurrent_task **tasks;
+	concurrent_task *task;
+	zend_long now;
+	uint32_t count;
+	uint32_t i;
+	int num;
+
+	zval error;
+
+	now = concurrent_task_scheduler_now();
+	num = 0;
+
+	// Cancelled tasks run userland code while being unwound (and might register new deadlines), take a snapshot.
+	while (scheduler->deadlines != NULL && scheduler->deadlines->time <= now) {
+		deadline = scheduler->deadlines;
+		scheduler->deadlines = deadline->next;
+
+		count = zend_hash_num_elements(&deadline->tasks);
+		tasks = safe_emalloc(count, sizeof(concurrent_task *), 0);
+		i = 0;
+
+		ZEND_HASH_FOREACH_PTR(&deadline->tasks, task) {
+			GC_ADDREF(&task->fiber.std);
+			task->deadline = NULL;
+
+			tasks[i++] = task;
+		} ZEND_HASH_FOREACH_END();
+
+		zend_hash_destroy(&deadline->tasks);
+		efree(deadline);
+
+		concurrent_cancellation_create_exception(&error, "Deadline has been exceeded", NULL);
+
+		for (i = 0; i < count; i++) {
+			if (concurrent_task_cancel(tasks[i], &error)) {
+				num++;
+			}
+
+			OBJ_RELEASE(&tasks[i]->fiber.std);
+		}
+
+		zval_ptr_dtor(&error);
+		efree(tasks);
+	}
+
+	return num;
+}
+
+/* Returns the number of milliseconds until the next deadline of the scheduler expires, -1 if there is none. */
+static zend_long concurrent_task_scheduler_timeout(concurrent_task_scheduler *scheduler)
+{
+	zend_long timeout;
+
+	if (scheduler->deadlines == NULL) {
+		return -1;
+	}
+
+	timeout = scheduler->deadlines->time - concurrent_task_scheduler_now();
+
+	if (timeout <= 0) {
+		return 0;
+	}
+
+	// Native waits take the timeout as int, far deadlines are reached by waiting more than once.
+	return MIN((timeout + 999) / 1000, INT_MAX);
+}
+
+/* Blocks the process for the given number of milliseconds. */
+static void concurrent_task_scheduler_sleep(zend_long timeout)
+{
+#ifdef PHP_WIN32
+	Sleep((DWORD) timeout);
+#else
+	struct timespec ts;
+
+	ts.tv_sec = (time_t) (timeout / 1000);
+	ts.tv_nsec = (long) ((timeout % 1000) * 1000000);
+
+	nanosleep(&ts, NULL);
+#endif
+}
+
+static int concurrent_task_scheduler_poll(concurrent_task_scheduler *scheduler, zend_long timeout)
+{
+#ifdef CLOCK_MONOTONIC
+	zend_long spin_start;
+	zend_long spin_end;
+	int num;
+
+	// Busy-poll native watchers for a while in order to avoid the wake-up latency of blocking in the kernel.
+	if (TASK_G(spin_time) > 0 && timeout != 0) {
+		spin_start = concurrent_task_scheduler_now();
+		spin_end = spin_start + TASK_G(spin_time);
+
+		// Spinning must not overshoot the next deadline.
+		if (timeout > 0 && spin_end > spin_start + timeout * 1000) {
+			spin_end = spin_start + timeout * 1000;
+		}
+
+		do {
+			num = concurrent_io_watcher_poll(0);
+
+			if (num != 0) {
+				if (num > 0) {
+					scheduler->spin_hits++;
+				}
+
+				return num;
+			}
+		} while (concurrent_task_scheduler_now() < spin_end);
+
+		scheduler->spin_misses++;
+
+		if (timeout > 0) {
+			timeout = MAX(0, timeout - (concurrent_task_scheduler_now() - spin_start) / 1000);
+		}
+	}
+#endif
+
+	return concurrent_io_watcher_poll(timeout);
+}
+
+/*
+ * Waits for native watchers or the next deadline, whichever comes first. Returns the number of invoked watcher
+ * callbacks and cancelled tasks or -1 if there is nothing to wait for.
+ */
+static int concurrent_task_scheduler_wait(concurrent_task_scheduler *scheduler)
+{
+	zend_long timeout;
+	int num;
+
+	timeout = concurrent_task_scheduler_timeout(scheduler);
+
+	if (timeout != 0) {
+		num = concurrent_task_scheduler_poll(scheduler, timeout);
+
+		if (timeout < 0) {
+			return num;
+		}
+
+		// Nothing but pending deadlines, sleep until the next deadline expires.
+		if (num < 0) {
+			concurrent_task_scheduler_sleep(timeout);
+			num = 0;
+		}
+	} else {
+		num = 0;
+	}
+
+	return num + concurrent_task_scheduler_expire(scheduler);
+}
 
 static zend_object *concurrent_task_scheduler_object_create(zend_class_entry *ce)
 {
@@ -199,19 +647,43 @@ static zend_object *concurrent_task_scheduler_object_create(zend_class_entry *ce
 static void concurrent_task_scheduler_object_destroy(zend_object *object)
 {
 	concurrent_task_scheduler *scheduler;
+	concurrent_task_deadline *deadline;
 	concurrent_task *task;
 
 	scheduler = (concurrent_task_scheduler *) object;
 
-	while (scheduler->first != NULL) {
-		task = scheduler->first;
+	// Suspended tasks that outlive the scheduler must not unregister from its deadlines.
+	while (scheduler->deadlines != NULL) {
+		deadline = scheduler->deadlines;
+		scheduler->deadlines = deadline->next;
+
+		ZEND_HASH_FOREACH_PTR(&deadline->tasks, task) {
+			task->deadline = NULL;
+		} ZEND_HASH_FOREACH_END();
 
+		zend_hash_destroy(&deadline->tasks);
+		efree(deadline);
+	}
+
+	while ((task = concurrent_task_scheduler_dequeue(scheduler)) != NULL) {
 		scheduler->scheduled--;
-		scheduler->first = task->next;
+
+		// Queued tasks might outlive the scheduler, they must not keep a pointer to a tenant.
+		task->tenant = NULL;
 
 		OBJ_RELEASE(&task->fiber.std);
 	}
 
+	if (scheduler->tenants != NULL) {
+		zend_hash_destroy(scheduler->tenants);
+		FREE_HASHTABLE(scheduler->tenants);
+
+		scheduler->tenants = NULL;
+	}
+
+	zval_ptr_dtor(&scheduler->tenant_key);
+	ZVAL_UNDEF(&scheduler->tenant_key);
+
 	zend_object_std_dtor(&scheduler->std);
 }
 
@@ -226,6 +698,95 @@ ZEND_METHOD(TaskScheduler, count)
 	RETURN_LONG(scheduler->scheduled);
 }
 
+ZEND_METHOD(TaskScheduler, stats)
+{
+	concurrent_task_scheduler *scheduler;
+	concurrent_task_scheduler_tenant *tenant;
+	zend_string *name;
+
+	zval tenants;
+	zval entry;
+
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	scheduler = (concurrent_task_scheduler *) Z_OBJ_P(getThis());
+
+	array_init(return_value);
+
+	add_assoc_long(return_value, "spin_hits", (zend_long) scheduler->spin_hits);
+	add_assoc_long(return_value, "spin_misses", (zend_long) scheduler->spin_misses);
+
+	if (scheduler->tenants != NULL) {
+		array_init(&tenants);
+
+		ZEND_HASH_FOREACH_STR_KEY_PTR(scheduler->tenants, name, tenant) {
+			array_init(&entry);
+
+			add_assoc_long(&entry, "weight", tenant->weight);
+			add_assoc_long(&entry, "scheduled", (zend_long) tenant->scheduled);
+			add_assoc_long(&entry, "runs", (zend_long) tenant->runs);
+			add_assoc_long(&entry, "run_time", tenant->run_time);
+
+			zend_symtable_update(Z_ARRVAL(tenants), name, &entry);
+		} ZEND_HASH_FOREACH_END();
+
+		add_assoc_zval(return_value, "tenants", &tenants);
+	}
+}
+
+ZEND_METHOD(TaskScheduler, setTenantKey)
+{
+	concurrent_task_scheduler *scheduler;
+
+	zval *key;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 1, 1)
+		Z_PARAM_ZVAL(key)
+	ZEND_PARSE_PARAMETERS_END();
+
+	scheduler = (concurrent_task_scheduler *) Z_OBJ_P(getThis());
+
+	if (Z_TYPE(scheduler->tenant_key) != IS_UNDEF) {
+		zend_throw_error(NULL, "Tenant key of the task scheduler has already been set");
+		return;
+	}
+
+	if (scheduler->scheduled > 0) {
+		zend_throw_error(NULL, "Tenant key must be set before tasks are scheduled");
+		return;
+	}
+
+	// Validates the key, tenants are resolved when tasks are enqueued and must not throw at that point.
+	concurrent_context_lookup(concurrent_context_get(), key);
+
+	if (UNEXPECTED(EG(exception))) {
+		return;
+	}
+
+	ZVAL_COPY(&scheduler->tenant_key, key);
+}
+
+ZEND_METHOD(TaskScheduler, setTenantWeight)
+{
+	concurrent_task_scheduler *scheduler;
+	zend_string *name;
+	zend_long weight;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 2, 2)
+		Z_PARAM_STR(name)
+		Z_PARAM_LONG(weight)
+	ZEND_PARSE_PARAMETERS_END();
+
+	scheduler = (concurrent_task_scheduler *) Z_OBJ_P(getThis());
+
+	if (weight < 1 || weight > 1000000) {
+		zend_throw_error(NULL, "Tenant weight must be between 1 and 1000000");
+		return;
+	}
+
+	concurrent_task_scheduler_get_tenant(scheduler, name)->weight = weight;
+}
+
 ZEND_METHOD(TaskScheduler, activate)
 {
 	ZEND_PARSE_PARAMETERS_NONE();
@@ -352,6 +913,10 @@ ZEND_METHOD(TaskScheduler, dispatch)
 		return;
 	}
 
+	if (scheduler->deadlines != NULL) {
+		concurrent_task_scheduler_expire(scheduler);
+	}
+
 	concurrent_task_scheduler_run(scheduler);
 }
 
@@ -368,7 +933,10 @@ ZEND_METHOD(TaskScheduler, runLoop)
 		return;
 	}
 
-	concurrent_task_scheduler_run(scheduler);
+	// Block in the native wait whenever the run queue is drained, watcher callbacks will enqueue tasks.
+	do {
+		concurrent_task_scheduler_run(scheduler);
+	} while (!EG(exception) && concurrent_task_scheduler_wait(scheduler) >= 0);
 }
 
 ZEND_METHOD(TaskScheduler, setDefaultScheduler)
@@ -405,6 +973,18 @@ ZEND_METHOD(TaskScheduler, __wakeup)
 ZEND_BEGIN_ARG_INFO(arginfo_task_scheduler_count, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_task_scheduler_stats, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_scheduler_set_tenant_key, 0, 0, 1)
+	ZEND_ARG_INFO(0, key)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_task_scheduler_set_tenant_weight, 0, 0, 2)
+	ZEND_ARG_TYPE_INFO(0, tenant, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, weight, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO(arginfo_task_scheduler_activate, 0)
 ZEND_END_ARG_INFO()
 
@@ -434,6 +1014,9 @@ ZEND_END_ARG_INFO()
 
 static const zend_function_entry task_scheduler_functions[] = {
 	ZEND_ME(TaskScheduler, count, arginfo_task_scheduler_count, ZEND_ACC_PUBLIC | ZEND_ACC_FINAL)
+	ZEND_ME(TaskScheduler, stats, arginfo_task_scheduler_stats, ZEND_ACC_PUBLIC | ZEND_ACC_FINAL)
+	ZEND_ME(TaskScheduler, setTenantKey, arginfo_task_scheduler_set_tenant_key, ZEND_ACC_PUBLIC | ZEND_ACC_FINAL)
+	ZEND_ME(TaskScheduler, setTenantWeight, arginfo_task_scheduler_set_tenant_weight, ZEND_ACC_PUBLIC | ZEND_ACC_FINAL)
 	ZEND_ME(TaskScheduler, activate, arginfo_task_scheduler_activate, ZEND_ACC_PROTECTED)
 	ZEND_ME(TaskScheduler, run, arginfo_task_scheduler_run, ZEND_ACC_PUBLIC | ZEND_ACC_FINAL)
 	ZEND_ME(TaskScheduler, runWithContext, arginfo_task_scheduler_run_with_context, ZEND_ACC_PUBLIC | ZEND_ACC_FINAL)
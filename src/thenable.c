@@ -0,0 +1,273 @@
+/*
+  +----------------------------------------------------------------------+
+  | PHP Version 7                                                        |
+  +----------------------------------------------------------------------+
+  | Copyright (c) 1997-2018 The PHP Group                                |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 3.01 of the PHP license,      |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.php.net/license/3_01.txt                                  |
+  | If you did not receive a copy of the PHP license and are unable to   |
+  | obtain it through the world-wide-web, please send a note to          |
+  | license@php.net so we can mail you a copy immediately.               |
+  +----------------------------------------------------------------------+
+  | Authors: Martin Schröder <m.schroeder2007@gmail.com>                 |
+  +----------------------------------------------------------------------+
+*/
+
+#include "php.h"
+#include "zend.h"
+#include "zend_API.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+
+#include "php_task.h"
+
+zend_class_entry *concurrent_thenable_continuation_ce;
+
+static zend_object_handlers concurrent_thenable_continuation_handlers;
+
+
+/* Registers a class (or interface) whose instances are awaited using their then() method. */
+void concurrent_thenable_register(zend_class_entry *ce)
+{
+	if (!zend_hash_str_exists(&ce->function_table, "then", sizeof("then")-1)) {
+		zend_throw_error(NULL, "Cannot register %s as thenable because it does not declare a then() method", ZSTR_VAL(ce->name));
+		return;
+	}
+
+	if (TASK_G(thenables) == NULL) {
+		ALLOC_HASHTABLE(TASK_G(thenables));
+		zend_hash_init(TASK_G(thenables), 4, NULL, NULL, 0);
+	}
+
+	zend_hash_add_ptr(TASK_G(thenables), ce->name, ce);
+}
+
+zend_bool concurrent_thenable_is_thenable(zend_class_entry *ce)
+{
+	zend_class_entry *entry;
+
+	if (TASK_G(thenables) == NULL) {
+		return 0;
+	}
+
+	ZEND_HASH_FOREACH_PTR(TASK_G(thenables), entry) {
+		if (instanceof_function(ce, entry)) {
+			return 1;
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	return 0;
+}
+
+static void concurrent_thenable_continuation_settle(concurrent_thenable_continuation *cont, zval *result, zend_bool success)
+{
+	concurrent_task *task;
+
+	// Thenables must settle only once, additional calls are ignored.
+	if (cont->status != CONCURRENT_DEFERRED_STATUS_PENDING) {
+		return;
+	}
+
+	ZVAL_COPY(&cont->result, result);
+
+	cont->status = success ? CONCURRENT_DEFERRED_STATUS_RESOLVED : CONCURRENT_DEFERRED_STATUS_FAILED;
+
+	if (cont->task != NULL) {
+		task = cont->task;
+		cont->task = NULL;
+
+		concurrent_task_continuation(task, &cont->result, success);
+	}
+}
+
+/*
+ * Passes a single continuation object to then(), the object is invoked on success and its fail() method is used as
+ * rejection callback. Thenables that settle synchronously during then() do not suspend the task.
+ */
+void concurrent_thenable_await(concurrent_task *task, zval *thenable, zval *return_value, zend_execute_data *execute_data)
+{
+	concurrent_thenable_continuation *cont;
+
+	zval obj;
+	zval reject;
+	zval retval;
+
+	object_init_ex(&obj, concurrent_thenable_continuation_ce);
+
+	cont = (concurrent_thenable_continuation *) Z_OBJ(obj);
+
+	array_init_size(&reject, 2);
+	Z_ADDREF(obj);
+	add_next_index_zval(&reject, &obj);
+	add_next_index_stringl(&reject, "fail", sizeof("fail")-1);
+
+	ZVAL_UNDEF(&retval);
+
+	zend_call_method_with_2_params(thenable, Z_OBJCE_P(thenable), NULL, "then", &retval, &obj, &reject);
+
+	zval_ptr_dtor(&retval);
+	zval_ptr_dtor(&reject);
+
+	if (UNEXPECTED(EG(exception))) {
+		zval_ptr_dtor(&obj);
+		return;
+	}
+
+	if (cont->status == CONCURRENT_DEFERRED_STATUS_PENDING) {
+		cont->task = task;
+
+		concurrent_task_suspend(task, return_value, execute_data);
+
+		// The task is not referenced by the continuation, it must not be continued after it has been unwound.
+		cont->task = NULL;
+	} else if (cont->status == CONCURRENT_DEFERRED_STATUS_RESOLVED) {
+		ZVAL_COPY(return_value, &cont->result);
+	} else {
+		Z_ADDREF(cont->result);
+
+		execute_data->opline--;
+		zend_throw_exception_internal(&cont->result);
+		execute_data->opline++;
+	}
+
+	zval_ptr_dtor(&obj);
+}
+
+static zend_object *concurrent_thenable_continuation_object_create(zend_class_entry *ce)
+{
+	concurrent_thenable_continuation *cont;
+
+	cont = emalloc(sizeof(concurrent_thenable_continuation));
+	ZEND_SECURE_ZERO(cont, sizeof(concurrent_thenable_continuation));
+
+	cont->status = CONCURRENT_DEFERRED_STATUS_PENDING;
+
+	ZVAL_UNDEF(&cont->result);
+
+	zend_object_std_init(&cont->std, ce);
+	cont->std.handlers = &concurrent_thenable_continuation_handlers;
+
+	return &cont->std;
+}
+
+static void concurrent_thenable_continuation_object_destroy(zend_object *object)
+{
+	concurrent_thenable_continuation *cont;
+
+	cont = (concurrent_thenable_continuation *) object;
+
+	zval_ptr_dtor(&cont->result);
+
+	zend_object_std_dtor(&cont->std);
+}
+
+ZEND_METHOD(ThenableContinuation, __construct)
+{
+	ZEND_PARSE_PARAMETERS_NONE();
+
+	zend_throw_error(NULL, "Thenable continuation must not be created from userland code");
+}
+
+ZEND_METHOD(ThenableContinuation, __invoke)
+{
+	zval *val;
+	zval tmp;
+
+	val = NULL;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_ZVAL(val)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (val == NULL) {
+		ZVAL_NULL(&tmp);
+		val = &tmp;
+	}
+
+	concurrent_thenable_continuation_settle((concurrent_thenable_continuation *) Z_OBJ_P(getThis()), val, 1);
+}
+
+ZEND_METHOD(ThenableContinuation, fail)
+{
+	zval *reason;
+	zval error;
+
+	reason = NULL;
+
+	ZEND_PARSE_PARAMETERS_START_EX(ZEND_PARSE_PARAMS_THROW, 0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_ZVAL(reason)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (reason != NULL && Z_TYPE_P(reason) == IS_OBJECT && instanceof_function(Z_OBJCE_P(reason), zend_ce_throwable)) {
+		concurrent_thenable_continuation_settle((concurrent_thenable_continuation *) Z_OBJ_P(getThis()), reason, 0);
+		return;
+	}
+
+	// Rejection reasons are not required to be errors by most promise libraries.
+	object_init_ex(&error, zend_ce_error);
+	zend_update_property_string(zend_ce_error, &error, "message", sizeof("message")-1, "Thenable has been rejected without an error");
+
+	concurrent_thenable_continuation_settle((concurrent_thenable_continuation *) Z_OBJ_P(getThis()), &error, 0);
+
+	zval_ptr_dtor(&error);
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_thenable_continuation_ctor, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_thenable_continuation_invoke, 0, 0, 0)
+	ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_thenable_continuation_fail, 0, 0, 0)
+	ZEND_ARG_INFO(0, reason)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry thenable_continuation_functions[] = {
+	ZEND_ME(ThenableContinuation, __construct, arginfo_thenable_continuation_ctor, ZEND_ACC_PRIVATE | ZEND_ACC_CTOR)
+	ZEND_ME(ThenableContinuation, __invoke, arginfo_thenable_continuation_invoke, ZEND_ACC_PUBLIC)
+	ZEND_ME(ThenableContinuation, fail, arginfo_thenable_continuation_fail, ZEND_ACC_PUBLIC)
+	ZEND_FE_END
+};
+
+
+void concurrent_thenable_ce_register()
+{
+	zend_class_entry ce;
+
+	INIT_CLASS_ENTRY(ce, "Concurrent\\ThenableContinuation", thenable_continuation_functions);
+	concurrent_thenable_continuation_ce = zend_register_internal_class(&ce);
+	concurrent_thenable_continuation_ce->ce_flags |= ZEND_ACC_FINAL;
+	concurrent_thenable_continuation_ce->create_object = concurrent_thenable_continuation_object_create;
+	concurrent_thenable_continuation_ce->serialize = zend_class_serialize_deny;
+	concurrent_thenable_continuation_ce->unserialize = zend_class_unserialize_deny;
+
+	memcpy(&concurrent_thenable_continuation_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+	concurrent_thenable_continuation_handlers.free_obj = concurrent_thenable_continuation_object_destroy;
+	concurrent_thenable_continuation_handlers.clone_obj = NULL;
+}
+
+void concurrent_thenable_shutdown()
+{
+	HashTable *thenables;
+
+	thenables = TASK_G(thenables);
+
+	if (thenables != NULL) {
+		TASK_G(thenables) = NULL;
+
+		zend_hash_destroy(thenables);
+		FREE_HASHTABLE(thenables);
+	}
+}
+
+
+/*
+ * vim: sw=4 ts=4
+ * vim600: fdm=marker
+ */
@@ -0,0 +1,45 @@
+--TEST--
+Tasks awaiting the same signal are continued in one batch.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+if (!extension_loaded('posix') || !extension_loaded('pcntl')) echo 'Test requires the posix and pcntl extensions to be loaded';
+if (PHP_OS !== 'Linux') echo 'Test requires signalfd support';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $work = function (string $title) {
+        var_dump($title . ' waiting');
+        var_dump(Task::awaitSignal(SIGUSR1) === SIGUSR1);
+        var_dump($title . ' done');
+    };
+
+    Task::async($work, ['A']);
+    Task::async($work, ['B']);
+    
+    Task::async(function () {
+        posix_kill(getmypid(), SIGUSR1);
+    });
+});
+
+try {
+    Task::awaitSignal(SIGUSR1);
+} catch (\Error $e) {
+    var_dump($e->getMessage());
+}
+
+?>
+--EXPECT--
+string(9) "A waiting"
+string(9) "B waiting"
+bool(true)
+string(6) "A done"
+bool(true)
+string(6) "B done"
+string(47) "Await must be called from within a running task"
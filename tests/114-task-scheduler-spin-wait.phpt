@@ -0,0 +1,46 @@
+--TEST--
+Task scheduler busy-polls native watchers before blocking.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+if (!extension_loaded('posix') || !extension_loaded('pcntl')) echo 'Test requires the posix and pcntl extensions to be loaded';
+if (PHP_OS !== 'Linux') echo 'Test requires signalfd support';
+?>
+--INI--
+task.spin_time=1000000
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+var_dump($scheduler->stats());
+
+$scheduler->run(function () {
+    Task::async(function () {
+        var_dump(Task::awaitSignal(SIGUSR2) === SIGUSR2);
+    });
+    
+    Task::async(function () {
+        posix_kill(getmypid(), SIGUSR2);
+    });
+});
+
+var_dump($scheduler->stats());
+
+?>
+--EXPECT--
+array(2) {
+  ["spin_hits"]=>
+  int(0)
+  ["spin_misses"]=>
+  int(0)
+}
+bool(true)
+array(2) {
+  ["spin_hits"]=>
+  int(1)
+  ["spin_misses"]=>
+  int(0)
+}
@@ -0,0 +1,75 @@
+--TEST--
+Task combinators await multiple awaitables with a single suspension.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $a = new Deferred();
+    $b = new Deferred();
+
+    Task::async(function () use ($a, $b) {
+        $b->resolve('B');
+        $a->resolve('A');
+    });
+
+    var_dump(Task::awaitAll(['x' => $a->awaitable(), 'y' => $b->awaitable(), 'z' => 3]));
+    var_dump(Task::awaitAll([]));
+
+    $d = new Deferred();
+
+    var_dump(Task::awaitAny([$d->awaitable(), Deferred::value('now')]));
+
+    try {
+        Task::awaitAll([$d->awaitable(), Deferred::error(new \Error('C'))]);
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    $d->resolve('late');
+
+    $d = new Deferred();
+
+    Task::async(function () use ($d) {
+        $d->resolve('ok');
+    });
+
+    var_dump(Task::awaitFirstSuccessful([Deferred::error(new \Error('A')), $d->awaitable()]));
+
+    try {
+        Task::awaitFirstSuccessful([Deferred::error(new \Error('A')), Deferred::error(new \Error('B'))]);
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    try {
+        Task::awaitAny([]);
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+});
+
+?>
+--EXPECT--
+array(3) {
+  ["x"]=>
+  string(1) "A"
+  ["y"]=>
+  string(1) "B"
+  ["z"]=>
+  int(3)
+}
+array(0) {
+}
+string(3) "now"
+string(1) "C"
+string(2) "ok"
+string(1) "B"
+string(41) "Cannot await an empty array of awaitables"
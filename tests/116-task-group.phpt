@@ -0,0 +1,86 @@
+--TEST--
+Task group awaits all children and cancels pending children.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $group = new TaskGroup();
+
+    $group->spawn(function () {
+        return 1;
+    });
+
+    $group->spawn(function ($v) {
+        return $v;
+    }, [2]);
+
+    var_dump(count($group));
+    var_dump($group->awaitAll());
+    var_dump(count($group));
+
+    $defer = new Deferred();
+    $group = new TaskGroup();
+
+    $group->spawn(function () use ($defer) {
+        try {
+            Task::await($defer->awaitable());
+        } finally {
+            var_dump('unwound');
+        }
+    });
+
+    $group->spawn(function () {
+        throw new \Error('Fail');
+    });
+
+    try {
+        $group->awaitAll();
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    $group = new TaskGroup();
+
+    $group->spawn(function () use ($defer) {
+        try {
+            Task::await($defer->awaitable());
+        } catch (CancellationException $e) {
+            var_dump($e->getMessage());
+        }
+    });
+
+    $ready = new Deferred();
+
+    Task::async(function () use ($ready) {
+        $ready->resolve();
+    });
+
+    Task::await($ready->awaitable());
+
+    $group = null;
+
+    var_dump('done');
+});
+
+?>
+--EXPECT--
+int(2)
+array(2) {
+  [0]=>
+  int(1)
+  [1]=>
+  int(2)
+}
+int(0)
+string(7) "unwound"
+string(4) "Fail"
+string(28) "Task group has been disposed"
+string(4) "done"
@@ -0,0 +1,90 @@
+--TEST--
+Task cancellation unwinds suspended tasks and propagates through context cancellation tokens.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $yield = function () {
+        $defer = new Deferred();
+
+        Task::async(function () use ($defer) {
+            $defer->resolve();
+        });
+
+        Task::await($defer->awaitable());
+    };
+
+    $defer = new Deferred();
+
+    $t = Task::async(function () use ($defer) {
+        try {
+            Task::await($defer->awaitable());
+        } catch (CancellationException $e) {
+            var_dump($e->getMessage());
+
+            throw $e;
+        }
+    });
+
+    $yield();
+
+    $t->cancel();
+
+    try {
+        Task::await($t);
+    } catch (CancellationException $e) {
+        var_dump('awaited ' . $e->getMessage());
+    }
+
+    $token = new CancellationToken();
+    $context = Context::current()->withCancellationToken($token);
+
+    var_dump($context->getCancellationToken() === $token);
+    var_dump(Context::current()->getCancellationToken());
+
+    Task::asyncWithContext($context->with('x', 1), function () use ($defer) {
+        try {
+            Task::await($defer->awaitable());
+        } catch (CancellationException $e) {
+            var_dump('a ' . $e->getMessage());
+        }
+    });
+
+    Task::asyncWithContext($context, function () {
+        var_dump('b started');
+    });
+
+    $yield();
+
+    $token->cancel();
+    var_dump($token->isCancelled());
+
+    $c = Task::asyncWithContext($context, function () {
+        var_dump('never');
+    });
+
+    try {
+        Task::await($c);
+    } catch (CancellationException $e) {
+        var_dump('c ' . $e->getMessage());
+    }
+});
+
+?>
+--EXPECT--
+string(23) "Task has been cancelled"
+string(31) "awaited Task has been cancelled"
+bool(true)
+NULL
+string(9) "b started"
+string(30) "a Operation has been cancelled"
+bool(true)
+string(30) "c Operation has been cancelled"
@@ -0,0 +1,73 @@
+--TEST--
+Task select resumes on the first candidate and unregisters all losing candidates.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $channel = new Channel();
+    $timeout = new Deferred();
+    $shutdown = new Deferred();
+
+    Task::async(function () use ($channel) {
+        $channel->send('hello');
+    });
+
+    var_dump(Task::select([
+        'timeout' => $timeout->awaitable(),
+        'message' => $channel,
+        'shutdown' => $shutdown->awaitable()
+    ]));
+
+    var_dump(Task::select([1 => $timeout->awaitable(), 2 => Deferred::value('ready')]));
+
+    Task::async(function () use ($shutdown) {
+        $shutdown->resolve('stop');
+    });
+
+    var_dump(Task::select(['message' => $channel, 'shutdown' => $shutdown->awaitable()]));
+
+    Task::async(function () use ($channel) {
+        $channel->send('after');
+    });
+
+    var_dump($channel->receive());
+
+    try {
+        Task::select([Deferred::error(new \Error('Failed'))]);
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    $timeout->resolve();
+});
+
+?>
+--EXPECT--
+array(2) {
+  [0]=>
+  string(7) "message"
+  [1]=>
+  string(5) "hello"
+}
+array(2) {
+  [0]=>
+  int(2)
+  [1]=>
+  string(5) "ready"
+}
+array(2) {
+  [0]=>
+  string(8) "shutdown"
+  [1]=>
+  string(4) "stop"
+}
+string(5) "after"
+string(6) "Failed"
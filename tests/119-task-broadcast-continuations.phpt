@@ -0,0 +1,92 @@
+--TEST--
+Task resumes every awaiting task in registration order.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$yield = function () {
+    $defer = new Deferred();
+
+    Task::async(function () use ($defer) {
+        $defer->resolve();
+    });
+
+    Task::await($defer->awaitable());
+};
+
+$scheduler->run(function () use ($yield) {
+    $defer = new Deferred();
+
+    $t = Task::async(function () use ($defer) {
+        return Task::await($defer->awaitable());
+    });
+
+    $order = [];
+    $tasks = [];
+
+    for ($i = 0; $i < 10000; $i++) {
+        $tasks[] = Task::async(function () use ($t, $i, & $order) {
+            $v = Task::await($t);
+            $order[] = $i;
+
+            return $v + $i;
+        });
+    }
+
+    $yield();
+
+    // Removing the last continuation must not break appending further continuations.
+    array_pop($tasks)->cancel();
+
+    $tasks[] = Task::async(function () use ($t, & $order) {
+        $v = Task::await($t);
+        $order[] = 9999;
+
+        return $v + 9999;
+    });
+
+    $yield();
+
+    $defer->resolve(1);
+
+    var_dump(array_sum(Task::awaitAll($tasks)));
+    var_dump($order === range(0, 9999));
+});
+
+$scheduler->run(function () use ($yield) {
+    $defer = new Deferred();
+
+    $tasks = [];
+
+    for ($i = 0; $i < 3; $i++) {
+        $tasks[] = Task::async(function () use ($defer, $i) {
+            return Task::await($defer->awaitable()) . $i;
+        });
+    }
+
+    $yield();
+
+    $defer->resolve('D');
+
+    var_dump(Task::awaitAll($tasks));
+});
+
+?>
+--EXPECT--
+int(50005000)
+bool(true)
+array(3) {
+  [0]=>
+  string(2) "D0"
+  [1]=>
+  string(2) "D1"
+  [2]=>
+  string(2) "D2"
+}
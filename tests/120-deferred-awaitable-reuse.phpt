@@ -0,0 +1,59 @@
+--TEST--
+Deferred reuses awaitables and shares resolved awaitables.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$defer = new Deferred();
+
+var_dump($defer->awaitable() === $defer->awaitable());
+var_dump(Deferred::value() === Deferred::value(null));
+var_dump(Deferred::value(true) === Deferred::value(true));
+var_dump(Deferred::value(false) === Deferred::value(true));
+var_dump(Deferred::value(1) === Deferred::value(1));
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () use ($defer) {
+    var_dump(Task::await(Deferred::value()));
+    var_dump(Task::await(Deferred::value(false)));
+    var_dump(Task::await(Deferred::value('A')));
+
+    try {
+        Task::await(Deferred::error(new \Error('B')));
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    var_dump(Task::awaitAll([Deferred::value(true), Deferred::value('C')]));
+
+    Task::async(function () use ($defer) {
+        $defer->resolve('D');
+    });
+
+    var_dump(Task::await($defer->awaitable()));
+});
+
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+bool(false)
+NULL
+bool(false)
+string(1) "A"
+string(1) "B"
+array(2) {
+  [0]=>
+  bool(true)
+  [1]=>
+  string(1) "C"
+}
+string(1) "D"
@@ -0,0 +1,73 @@
+--TEST--
+Awaitable transforms results without creating a task.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    var_dump(Task::await(Deferred::value(2)->map(function ($v) {
+        return $v * 3;
+    })));
+
+    $defer = new Deferred();
+
+    $a = $defer->awaitable()->map(function ($v) {
+        return $v . 'B';
+    })->map(function ($v) {
+        throw new \Error($v . 'C');
+    })->map(function ($v) {
+        return 'skipped';
+    })->catch(function (\Throwable $e) {
+        return $e->getMessage() . 'D';
+    })->finally(function () {
+        var_dump('finally');
+    });
+
+    Task::async(function () use ($defer) {
+        $defer->resolve('A');
+    });
+
+    var_dump(Task::await($a));
+
+    $t = Task::async(function () {
+        throw new \Error('E');
+    });
+
+    try {
+        Task::await($t->finally(function () {
+            var_dump('cleanup');
+        }));
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    // Awaitables returned from a callback are adopted.
+    var_dump(Task::await(Deferred::value('F')->map(function ($v) {
+        return Task::async(function () use ($v) {
+            return $v . 'G';
+        });
+    })));
+
+    var_dump(Task::await(Deferred::error(new \Error('H'))->catch(function ($e) {
+        return Deferred::error(new \Error($e->getMessage() . 'I'));
+    })->catch(function ($e) {
+        return $e->getMessage();
+    })));
+});
+
+?>
+--EXPECT--
+int(6)
+string(7) "finally"
+string(4) "ABCD"
+string(7) "cleanup"
+string(1) "E"
+string(2) "FG"
+string(2) "HI"
@@ -0,0 +1,93 @@
+--TEST--
+Task can await registered thenables.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+interface PromiseInterface
+{
+    public function then(callable $a = null, callable $b = null);
+}
+
+class Promise implements PromiseInterface
+{
+    private $callbacks = [];
+
+    private $outcome;
+
+    public function then(callable $a = null, callable $b = null)
+    {
+        if ($this->outcome) {
+            ($this->outcome[0] ? $a : $b)($this->outcome[1]);
+        } else {
+            $this->callbacks[] = [$a, $b];
+        }
+    }
+
+    public function settle(bool $success, $value)
+    {
+        $this->outcome = [$success, $value];
+
+        foreach ($this->callbacks as $cb) {
+            ($success ? $cb[0] : $cb[1])($value);
+        }
+    }
+}
+
+$p = new Promise();
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () use ($p) {
+    var_dump(Task::await($p) === $p);
+
+    Task::registerThenable(PromiseInterface::class);
+
+    try {
+        Task::registerThenable(\stdClass::class);
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    Task::async(function () use ($p) {
+        $p->settle(true, 'A');
+    });
+
+    var_dump(Task::await($p));
+    var_dump(Task::await($p));
+
+    $p = new Promise();
+    $p->settle(false, new \Error('B'));
+
+    try {
+        Task::await($p);
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    $p = new Promise();
+
+    Task::async(function () use ($p) {
+        $p->settle(false, 'C');
+    });
+
+    try {
+        Task::await($p);
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+});
+
+?>
+--EXPECT--
+bool(true)
+string(80) "Cannot register stdClass as thenable because it does not declare a then() method"
+string(1) "A"
+string(1) "A"
+string(1) "B"
+string(43) "Thenable has been rejected without an error"
@@ -0,0 +1,84 @@
+--TEST--
+Task scheduler serves tenants using weighted fair scheduling.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+function schedule(TaskScheduler $scheduler): array
+{
+    return $scheduler->run(function () {
+        $order = [];
+        $tasks = [];
+
+        $spawn = function (string $tenant, int $num) use (& $order, & $tasks) {
+            $context = Context::inherit(['tenant' => $tenant]);
+
+            for ($i = 0; $i < $num; $i++) {
+                $tasks[] = Task::asyncWithContext($context, function () use ($tenant, & $order) {
+                    usleep(3000);
+
+                    $order[] = $tenant;
+                });
+            }
+        };
+
+        $spawn('a', 6);
+        $spawn('b', 1);
+
+        Task::awaitAll($tasks);
+
+        return $order;
+    });
+}
+
+$scheduler = new TaskScheduler();
+echo implode('', schedule($scheduler)), "\n";
+
+$scheduler = new TaskScheduler();
+$scheduler->setTenantKey('tenant');
+echo implode('', schedule($scheduler)), "\n";
+
+// Idle tenants with default weight are dropped.
+var_dump($scheduler->stats()['tenants']);
+
+$scheduler = new TaskScheduler();
+$scheduler->setTenantKey('tenant');
+$scheduler->setTenantWeight('a', 5);
+
+echo implode('', schedule($scheduler)), "\n";
+
+foreach ($scheduler->stats()['tenants'] as $name => $tenant) {
+    var_dump($name, $tenant['weight'], $tenant['runs'], $tenant['scheduled'], $tenant['run_time'] >= 3000);
+}
+
+try {
+    $scheduler->setTenantKey('foo');
+} catch (\Error $e) {
+    var_dump($e->getMessage());
+}
+
+try {
+    $scheduler->setTenantWeight('a', 0);
+} catch (\Error $e) {
+    var_dump($e->getMessage());
+}
+
+?>
+--EXPECTF--
+aaaaaab
+abaaaaa
+array(0) {
+}
+aabaaaa
+string(1) "a"
+int(5)
+int(6)
+int(0)
+bool(true)
+string(53) "Tenant key of the task scheduler has already been set"
+string(43) "Tenant weight must be between 1 and 1000000"
@@ -0,0 +1,110 @@
+--TEST--
+Task local stores a separate value in each task.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+class Resource
+{
+    public $name;
+
+    public function __construct(string $name)
+    {
+        $this->name = $name;
+    }
+
+    public function __destruct()
+    {
+        echo "DESTROY {$this->name}\n";
+    }
+}
+
+$counter = new TaskLocal();
+$resource = new TaskLocal();
+
+try {
+    $counter->get();
+} catch (\Error $e) {
+    echo $e->getMessage(), "\n";
+}
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () use ($counter, $resource) {
+    $tasks = [];
+
+    foreach (['A', 'B'] as $name) {
+        $tasks[] = Task::async(function () use ($counter, $resource, $name) {
+            var_dump($counter->get());
+
+            $resource->set(new Resource($name));
+
+            for ($i = 0; $i < 3; $i++) {
+                $counter->set($counter->get() + 1);
+
+                Task::await(Task::async(function () {}));
+            }
+
+            return $name . ':' . $counter->get() . ':' . $resource->get()->name;
+        });
+    }
+
+    var_dump(Task::awaitAll($tasks));
+
+    $tasks = null;
+
+    var_dump($counter->get());
+
+    $local = new TaskLocal();
+    $local->set('local');
+    $local = null;
+
+    $local = new TaskLocal();
+    var_dump($local->get());
+
+    $defer = new Deferred();
+
+    $c = Task::async(function () use ($resource, $defer) {
+        $resource->set(new Resource('C'));
+
+        try {
+            Task::await($defer->awaitable());
+        } finally {
+            var_dump($resource->get()->name);
+            $resource->set(null);
+        }
+    });
+
+    $wakeup = new Deferred();
+
+    Task::async(function () use ($wakeup) {
+        $wakeup->resolve();
+    });
+
+    Task::await($wakeup->awaitable());
+
+    $c->cancel();
+});
+
+?>
+--EXPECT--
+Task locals can only be accessed from within a task
+NULL
+NULL
+array(2) {
+  [0]=>
+  string(5) "A:3:A"
+  [1]=>
+  string(5) "B:3:B"
+}
+DESTROY A
+DESTROY B
+NULL
+NULL
+string(1) "C"
+DESTROY C
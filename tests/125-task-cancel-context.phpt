@@ -0,0 +1,51 @@
+--TEST--
+Task cancellation restores the context of the cancelling task.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $yield = function () {
+        $defer = new Deferred();
+
+        Task::async(function () use ($defer) {
+            $defer->resolve();
+        });
+
+        Task::await($defer->awaitable());
+    };
+
+    $outer = Task::asyncWithContext(Context::inherit(['name' => 'outer']), function () use ($yield) {
+        $defer = new Deferred();
+
+        $t = Task::asyncWithContext(Context::inherit(['name' => 'inner']), function () use ($defer) {
+            try {
+                Task::await($defer->awaitable());
+            } catch (CancellationException $e) {
+                var_dump(Context::var('name'));
+            }
+        });
+
+        $yield();
+
+        $t->cancel();
+
+        var_dump(Context::var('name'));
+        var_dump(Context::current()->get('name'));
+    });
+
+    Task::await($outer);
+});
+
+?>
+--EXPECT--
+string(5) "inner"
+string(5) "outer"
+string(5) "outer"
@@ -0,0 +1,71 @@
+--TEST--
+Awaitable transform callbacks cannot suspend the resolving task and run while errors propagate.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+class Guard
+{
+    public $defer;
+
+    public function __destruct()
+    {
+        $this->defer->fail(new \Exception('guard'));
+    }
+}
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $defer = new Deferred();
+
+    $a = $defer->awaitable()->map(function ($v) {
+        try {
+            Task::await((new Deferred())->awaitable());
+        } catch (\Error $e) {
+            var_dump($e->getMessage());
+        }
+
+        return $v + 1;
+    });
+
+    $defer->resolve(1);
+
+    var_dump(Task::await($a));
+
+    $defer = new Deferred();
+
+    $b = $defer->awaitable()->finally(function () {
+        var_dump('finally');
+    });
+
+    try {
+        (function () use ($defer) {
+            $guard = new Guard();
+            $guard->defer = $defer;
+
+            throw new \Exception('outer');
+        })();
+    } catch (\Exception $e) {
+        var_dump($e->getMessage());
+    }
+
+    try {
+        Task::await($b);
+    } catch (\Exception $e) {
+        var_dump($e->getMessage());
+    }
+});
+
+?>
+--EXPECT--
+string(94) "Cannot suspend a task from within an awaitable transform callback, return an awaitable instead"
+int(2)
+string(7) "finally"
+string(5) "outer"
+string(5) "guard"
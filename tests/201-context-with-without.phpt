@@ -0,0 +1,59 @@
+--TEST--
+Context versions created by with() and without() are independent.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$contexts = [Context::inherit(['a' => 'A'])];
+
+for ($i = 0; $i < 1000; $i++) {
+    $contexts[] = end($contexts)->with('k' . $i, $i);
+}
+
+$ok = true;
+
+foreach ($contexts as $n => $context) {
+    for ($i = 0; $i < 1000; $i++) {
+        $ok = $ok && ($context->get('k' . $i) === ($i < $n ? $i : null));
+    }
+}
+
+var_dump($ok);
+var_dump($contexts[1000]->get('a'));
+
+$context = $contexts[1000];
+
+for ($i = 0; $i < 1000; $i += 2) {
+    $context = $context->without('k' . $i);
+}
+
+$ok = true;
+
+for ($i = 0; $i < 1000; $i++) {
+    $ok = $ok && ($context->get('k' . $i) === ($i % 2 ? $i : null));
+}
+
+var_dump($ok);
+var_dump($contexts[1000]->get('k500'));
+
+$a = $contexts[0]->with('x', 1);
+$b = $a->with('x', 2);
+$c = $b->without('x');
+
+var_dump($a->get('x'), $b->get('x'), $c->get('x'), $c->get('a'));
+
+?>
+--EXPECT--
+bool(true)
+string(1) "A"
+bool(true)
+int(500)
+int(1)
+int(2)
+NULL
+string(1) "A"
@@ -0,0 +1,59 @@
+--TEST--
+Context keys are looked up in the active context without walking parent contexts.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$id = new ContextKey('request-id');
+$user = new ContextKey();
+
+var_dump($id->getDescription());
+var_dump(Context::var($id));
+
+$context = Context::inherit()->with($id, 'R1')->with('id', 'string');
+
+for ($i = 0; $i < 10; $i++) {
+    $context = Context::inherit()->run(function () use ($context) {
+        return $context->run(function () {
+            return Context::inherit();
+        });
+    });
+}
+
+$context->run(function () use ($id, $user) {
+    var_dump(Context::var($id));
+    var_dump(Context::var($user));
+    var_dump(Context::var('id'));
+});
+
+$a = $context->with($user, 'U1');
+$b = $a->without($id);
+
+var_dump($a->get($id), $a->get($user), $b->get($id), $b->get($user), $b->get('id'));
+var_dump((new ContextKey())->getDescription() === '');
+
+try {
+    $context->get([]);
+} catch (\TypeError $e) {
+    var_dump($e->getMessage());
+}
+
+?>
+--EXPECT--
+string(10) "request-id"
+NULL
+string(2) "R1"
+NULL
+string(6) "string"
+string(2) "R1"
+string(2) "U1"
+NULL
+string(2) "U1"
+string(6) "string"
+bool(true)
+string(73) "Context variable must be a string or a Concurrent\ContextKey, array given"
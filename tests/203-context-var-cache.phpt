@@ -0,0 +1,50 @@
+--TEST--
+Context variable lookups are cached per context.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$context = Context::inherit([
+    'a' => 'A',
+    'b' => 'B'
+]);
+
+$child = $context->run(function () {
+    return Context::inherit(['c' => 'C']);
+});
+
+$child->run(function () {
+    $result = [];
+
+    for ($i = 0; $i < 3; $i++) {
+        foreach (['a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j'] as $name) {
+            $result[] = Context::var($name);
+        }
+    }
+
+    var_dump(implode('', $result));
+    var_dump(Context::var('a' . str_repeat('b', 0)));
+});
+
+$other = $child->with('a', 'X')->without('c');
+
+$other->run(function () {
+    var_dump(Context::var('a'), Context::var('c'), Context::var('b'));
+});
+
+var_dump($child->get('a'), $child->get('c'));
+
+?>
+--EXPECT--
+string(9) "ABCABCABC"
+string(1) "A"
+string(1) "X"
+NULL
+string(1) "B"
+string(1) "A"
+string(1) "C"
@@ -0,0 +1,60 @@
+--TEST--
+Context flattens long chains of inherited contexts.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--INI--
+task.context_depth=4
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$context = Context::current();
+
+for ($i = 0; $i < 10; $i++) {
+    $context = $context->run(function () use ($i) {
+        return Context::inherit([
+            'v' . $i => $i,
+            'shadow' => $i
+        ]);
+    });
+}
+
+$context->run(function () {
+    $values = [];
+
+    for ($i = 0; $i < 10; $i++) {
+        $values[] = Context::var('v' . $i);
+    }
+
+    var_dump(implode(',', $values));
+    var_dump(Context::var('shadow'));
+    var_dump(Context::var('missing'));
+
+    Context::background()->run(function () {
+        var_dump(Context::var('v0'), Context::var('shadow'));
+    });
+});
+
+$context = Context::current()->run(function () {
+    return Context::inherit(['a' => new \ArrayObject()]);
+});
+
+for ($i = 0; $i < 10; $i++) {
+    $context = $context->run(function () {
+        return Context::inherit();
+    });
+}
+
+var_dump(get_class($context->get('a')));
+
+?>
+--EXPECT--
+string(19) "0,1,2,3,4,5,6,7,8,9"
+int(9)
+NULL
+NULL
+NULL
+string(11) "ArrayObject"
@@ -0,0 +1,52 @@
+--TEST--
+Context run passes arguments and results and restores the previous context.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$context = Context::inherit(['foo' => 'bar']);
+
+var_dump($context->run(function () {
+    return Context::var('foo');
+}));
+
+var_dump($context->run(function (int ...$nums) {
+    return array_sum($nums) . Context::var('foo');
+}, 1, 2, 3));
+
+var_dump($context->run('strtoupper', 'abc'));
+
+$data = ['x' => 1];
+
+$result = $context->run(function &() use (&$data) {
+    return $data['x'];
+});
+
+$result++;
+
+var_dump($data['x'], $result);
+
+try {
+    $context->run(function () {
+        throw new \Exception(Context::var('foo'));
+    });
+} catch (\Exception $e) {
+    var_dump($e->getMessage());
+}
+
+var_dump(Context::var('foo'));
+
+?>
+--EXPECT--
+string(3) "bar"
+string(4) "6bar"
+string(3) "ABC"
+int(1)
+int(2)
+string(3) "bar"
+NULL
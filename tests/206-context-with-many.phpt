@@ -0,0 +1,64 @@
+--TEST--
+Context can derive a context with many variables at once.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$key = new ContextKey();
+
+$vars = [];
+
+for ($i = 0; $i < 100; $i++) {
+    $vars['v' . $i] = $i;
+}
+
+$context = Context::inherit(['a' => 'A', 'b' => 'B'])->with($key, 'K');
+
+$derived = $context->withMany($vars + [
+    'a' => 'X',
+    'b' => 'B',
+    5 => 'five'
+]);
+
+var_dump($derived->get('a'), $derived->get('b'), $derived->get('5'), $derived->get($key));
+
+$sum = 0;
+
+for ($i = 0; $i < 100; $i++) {
+    $sum += $derived->get('v' . $i);
+}
+
+var_dump($sum);
+
+var_dump($context->get('a'), $context->get('v1'));
+
+$ref = 'R';
+$derived = $context->withMany(['r' => & $ref]);
+$ref = 'changed';
+
+var_dump($derived->get('r'));
+var_dump($context->withMany([])->get('a'));
+
+try {
+    $context->withMany('foo');
+} catch (\TypeError $e) {
+    echo get_class($e), "\n";
+}
+
+?>
+--EXPECT--
+string(1) "X"
+string(1) "B"
+string(4) "five"
+string(1) "K"
+int(4950)
+string(1) "A"
+NULL
+string(1) "R"
+string(1) "A"
+TypeError
@@ -0,0 +1,65 @@
+--TEST--
+Context keeps variables when crossing the inline variable limit.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$context = Context::inherit(['a' => 'A']);
+$contexts = [$context];
+
+for ($i = 0; $i < 10; $i++) {
+    $contexts[] = $context = $context->with('v' . $i, $i);
+}
+
+foreach ([1, 7, 8, 10] as $i) {
+    $sum = 0;
+
+    for ($j = 0; $j < $i; $j++) {
+        $sum += $contexts[$i]->get('v' . $j);
+    }
+
+    var_dump($sum, $contexts[$i]->get('v' . $i));
+}
+
+$context = $contexts[8]->without('v3')->without('v4');
+
+var_dump($context->get('v3'), $context->get('v7'), $context->get('a'));
+
+$context = $context->with('v3', 'X');
+
+var_dump($context->get('v3'), $contexts[8]->get('v3'));
+
+$context = $contexts[6]->withMany(['v0' => 'Y', 'x' => 1, 'y' => 2, 'z' => 3]);
+
+var_dump($context->get('v0'), $context->get('v5'), $context->get('z'), $contexts[6]->get('v0'));
+
+$context = $contexts[10]->without('v9')->without('v8');
+
+var_dump($context->get('v8'), $context->get('v7'));
+
+?>
+--EXPECT--
+int(0)
+NULL
+int(21)
+NULL
+int(28)
+NULL
+int(45)
+NULL
+NULL
+int(7)
+string(1) "A"
+string(1) "X"
+int(3)
+string(1) "Y"
+int(5)
+int(3)
+int(0)
+NULL
+int(7)
@@ -0,0 +1,70 @@
+--TEST--
+Context deadlines are inherited and enforced at suspension points.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+var_dump(Context::current()->getDeadline());
+
+$context = Context::inherit(['a' => 1])->withDeadline(50);
+
+var_dump($context->getDeadline() > 0 && $context->getDeadline() <= 50);
+var_dump($context->withDeadline(1000)->getDeadline() <= 50);
+var_dump($context->with('b', 2)->getDeadline() !== null);
+var_dump(Context::background()->getDeadline());
+
+$never = new Deferred();
+
+$t = Task::asyncWithContext($context, function () use ($never) {
+    Task::async(function () use ($never) {
+        try {
+            Task::await($never->awaitable());
+        } catch (CancellationException $e) {
+            var_dump('sub: ' . $e->getMessage());
+        }
+    });
+
+    try {
+        Task::await($never->awaitable());
+    } catch (CancellationException $e) {
+        var_dump($e->getMessage());
+    }
+
+    return Context::var('a');
+});
+
+try {
+    Task::await($t);
+} catch (CancellationException $e) {
+    var_dump('await: ' . $e->getMessage());
+}
+
+$expired = Context::current()->withDeadline(0);
+
+var_dump($expired->getDeadline());
+
+var_dump(Task::await(Task::asyncWithContext($expired, function () use ($never) {
+    try {
+        Task::await($never->awaitable());
+    } catch (CancellationException $e) {
+        return $e->getMessage();
+    }
+})));
+
+?>
+--EXPECT--
+NULL
+bool(true)
+bool(true)
+bool(true)
+NULL
+string(26) "Deadline has been exceeded"
+string(31) "sub: Deadline has been exceeded"
+string(33) "await: Deadline has been exceeded"
+int(0)
+string(26) "Deadline has been exceeded"
@@ -0,0 +1,61 @@
+--TEST--
+Server accepts connections and runs a task per connection.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+if (DIRECTORY_SEPARATOR == '\\') echo 'Test requires a POSIX platform';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$clients = $scheduler->run(function () {
+    $server = null;
+    $count = 0;
+
+    $server = new Server('127.0.0.1', 0, function ($socket) use (& $server, & $count) {
+        var_dump(count($server));
+        
+        $line = trim(fgets($socket));
+        var_dump($line);
+        
+        fwrite($socket, strtolower($line) . "\n");
+        
+        if (++$count == 3) {
+            $server->close();
+        }
+    }, 2);
+    
+    var_dump(count($server));
+    
+    $clients = [];
+    
+    foreach (['A', 'B', 'C'] as $v) {
+        $client = stream_socket_client('tcp://127.0.0.1:' . $server->getPort());
+        fwrite($client, $v . "\n");
+        
+        $clients[] = $client;
+    }
+    
+    return $clients;
+});
+
+foreach ($clients as $client) {
+    var_dump(trim(fgets($client)));
+}
+
+?>
+--EXPECT--
+int(0)
+int(2)
+string(1) "A"
+int(1)
+string(1) "B"
+int(1)
+string(1) "C"
+string(1) "a"
+string(1) "b"
+string(1) "c"
@@ -0,0 +1,43 @@
+--TEST--
+Socket suspends tasks until data can be read or written.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+if (DIRECTORY_SEPARATOR == '\\') echo 'Test requires a POSIX platform';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $server = null;
+
+    $server = new Server('127.0.0.1', 0, function ($stream) use (& $server) {
+        $socket = new Socket($stream);
+        
+        while (null !== ($chunk = $socket->read())) {
+            $socket->write('[', $chunk, ']');
+        }
+        
+        $socket->close();
+        $server->close();
+        
+        var_dump('CLOSED');
+    });
+    
+    $client = new Socket(stream_socket_client('tcp://127.0.0.1:' . $server->getPort()));
+    
+    var_dump($client->write('Hello', ' ', 'World'));
+    var_dump($client->read());
+    
+    $client->close();
+});
+
+?>
+--EXPECT--
+int(11)
+string(13) "[Hello World]"
+string(6) "CLOSED"
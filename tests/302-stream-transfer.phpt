@@ -0,0 +1,55 @@
+--TEST--
+Stream transfer moves bytes between streams without PHP strings.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+if (DIRECTORY_SEPARATOR == '\\') echo 'Test requires a POSIX platform';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$file = tempnam(sys_get_temp_dir(), 'task');
+file_put_contents($file, str_repeat('A', 100000) . 'END');
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () use ($file) {
+    $server = null;
+
+    $server = new Server('127.0.0.1', 0, function ($stream) use (& $server, $file) {
+        $fp = fopen($file, 'rb');
+        
+        var_dump(fread($fp, 3));
+        var_dump(Stream::transfer($fp, $stream, 50000));
+        var_dump(Stream::transfer($fp, $stream));
+        
+        fclose($fp);
+        fclose($stream);
+        
+        $server->close();
+    });
+    
+    $client = stream_socket_client('tcp://127.0.0.1:' . $server->getPort());
+    
+    $socket = new Socket($client);
+    $received = '';
+    
+    while (null !== ($chunk = $socket->read())) {
+        $received .= $chunk;
+    }
+    
+    var_dump(strlen($received));
+    var_dump(substr($received, -3));
+});
+
+unlink($file);
+
+?>
+--EXPECT--
+string(3) "AAA"
+int(50000)
+int(50000)
+int(100000)
+string(3) "END"
@@ -0,0 +1,71 @@
+--TEST--
+Channel suspends senders and receivers.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $channel = new Channel(2);
+    
+    Task::async(function () use ($channel) {
+        for ($i = 0; $i < 5; $i++) {
+            $channel->send($i);
+            var_dump('SENT ' . $i);
+        }
+        
+        $channel->close();
+    });
+    
+    Task::async(function () use ($channel) {
+        try {
+            while (true) {
+                var_dump($channel->receive());
+            }
+        } catch (\Error $e) {
+            var_dump($e->getMessage());
+        }
+    });
+});
+
+$scheduler->run(function () {
+    $channel = new Channel();
+    
+    Task::async(function () use ($channel) {
+        var_dump($channel->receive());
+    });
+    
+    $channel->send('A');
+    var_dump(count($channel));
+    
+    Task::async(function () use ($channel) {
+        $channel->send('B');
+        var_dump('SENT B');
+    });
+    
+    var_dump($channel->receive());
+});
+
+?>
+--EXPECT--
+string(6) "SENT 0"
+string(6) "SENT 1"
+int(0)
+int(1)
+int(2)
+string(6) "SENT 2"
+string(6) "SENT 3"
+string(6) "SENT 4"
+int(3)
+int(4)
+string(44) "Cannot receive a value from a closed channel"
+string(1) "A"
+int(0)
+string(6) "SENT B"
+string(1) "B"
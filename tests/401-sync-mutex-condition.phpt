@@ -0,0 +1,106 @@
+--TEST--
+Mutex, semaphore and condition hand ownership to waiting tasks in FIFO order.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $yield = function () {
+        $defer = new Deferred();
+
+        Task::async(function () use ($defer) {
+            $defer->resolve();
+        });
+
+        Task::await($defer->awaitable());
+    };
+
+    $mutex = new Mutex();
+    $mutex->lock();
+
+    $work = function (string $title) use ($mutex) {
+        $mutex->lock();
+        var_dump($title . ' locked');
+        $mutex->unlock();
+    };
+
+    $a = Task::async($work, ['A']);
+    $b = Task::async($work, ['B']);
+
+    var_dump($mutex->tryLock());
+
+    $yield();
+
+    $mutex->unlock();
+    var_dump($mutex->isLocked());
+
+    Task::awaitAll([$a, $b]);
+    var_dump($mutex->isLocked());
+
+    $cond = new Condition();
+    $ready = false;
+
+    $t = Task::async(function () use ($mutex, $cond, & $ready) {
+        $mutex->lock();
+
+        while (!$ready) {
+            $cond->wait($mutex);
+        }
+
+        var_dump('ready');
+        $mutex->unlock();
+    });
+
+    $yield();
+
+    $mutex->lock();
+    $ready = true;
+    var_dump($cond->notifyAll());
+    $mutex->unlock();
+
+    Task::await($t);
+
+    try {
+        $cond->wait($mutex);
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    try {
+        $mutex->unlock();
+    } catch (\Error $e) {
+        var_dump($e->getMessage());
+    }
+
+    $sem = new Semaphore(1);
+
+    var_dump($sem->tryAcquire());
+    var_dump($sem->tryAcquire());
+    var_dump($sem->available());
+
+    $sem->release();
+    var_dump($sem->available());
+});
+
+?>
+--EXPECT--
+bool(false)
+bool(true)
+string(8) "A locked"
+string(8) "B locked"
+bool(false)
+int(1)
+string(5) "ready"
+string(52) "Cannot wait for a condition without owning the mutex"
+string(40) "Cannot unlock a mutex that is not locked"
+bool(true)
+bool(false)
+int(0)
+int(1)
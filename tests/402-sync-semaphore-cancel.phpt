@@ -0,0 +1,68 @@
+--TEST--
+Semaphore passes a permit granted to a cancelled task on to the next waiting task.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $yield = function () {
+        $defer = new Deferred();
+
+        Task::async(function () use ($defer) {
+            $defer->resolve();
+        });
+
+        Task::await($defer->awaitable());
+    };
+
+    $sem = new Semaphore(0);
+
+    $work = function (string $title) use ($sem) {
+        try {
+            $sem->acquire();
+        } catch (CancellationException $e) {
+            var_dump($title . ' cancelled');
+
+            return;
+        }
+
+        var_dump($title . ' acquired');
+    };
+
+    $a = Task::async($work, ['A']);
+    $b = Task::async($work, ['B']);
+    $c = Task::async($work, ['C']);
+
+    $yield();
+
+    // The permit is handed to A, A is cancelled before it is resumed.
+    $sem->release();
+    $a->cancel();
+
+    var_dump($sem->available());
+    var_dump($sem->tryAcquire());
+
+    $yield();
+
+    $sem->release();
+
+    Task::awaitAll([$b, $c]);
+
+    var_dump($sem->available());
+});
+
+?>
+--EXPECT--
+string(11) "A cancelled"
+int(0)
+bool(false)
+string(10) "B acquired"
+string(10) "C acquired"
+int(0)
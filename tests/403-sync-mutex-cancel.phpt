@@ -0,0 +1,61 @@
+--TEST--
+Mutex can be unlocked by a cancelled task that is being unwound.
+--SKIPIF--
+<?php
+if (!extension_loaded('task')) echo 'Test requires the task extension to be loaded';
+?>
+--FILE--
+<?php
+
+namespace Concurrent;
+
+$scheduler = new TaskScheduler();
+
+$scheduler->run(function () {
+    $yield = function () {
+        $defer = new Deferred();
+
+        Task::async(function () use ($defer) {
+            $defer->resolve();
+        });
+
+        Task::await($defer->awaitable());
+    };
+
+    $mutex = new Mutex();
+    $defer = new Deferred();
+
+    $a = Task::async(function () use ($mutex, $defer) {
+        $mutex->lock();
+
+        try {
+            Task::await($defer->awaitable());
+        } finally {
+            $mutex->unlock();
+            var_dump('A unlocked');
+        }
+    });
+
+    $b = Task::async(function () use ($mutex) {
+        $mutex->lock();
+        var_dump('B locked');
+        $mutex->unlock();
+    });
+
+    $yield();
+
+    var_dump($mutex->isLocked());
+
+    $a->cancel();
+
+    Task::await($b);
+
+    var_dump($mutex->isLocked());
+});
+
+?>
+--EXPECT--
+bool(true)
+string(10) "A unlocked"
+string(8) "B locked"
+bool(false)